@@ -16,10 +16,27 @@
 #define SS_DBUS_INTERFACE   "superswitcher.SuperSwitcher"
 
 
-// We need a GObject object to represent our D-Bus object.  Because the only
-// methods that we have exported over D-Bus are stateless and argumentless,
-// then we can get away with a simple "dummy" GObject, rather than having to
-// instantiate a custom subclass of GObject.
+// How often, at most, the StatsUpdated signal is emitted.  It is only
+// emitted after something has been measured, so an idle superswitcher is not
+// woken up just to say that nothing has changed.
+#define STATS_UPDATED_INTERVAL_MS 10000
+
+// We need a GObject object to represent our D-Bus object.  A D-Bus signal is
+// a GObject signal on that object, so it is an instance of a (small) custom
+// subclass of GObject, rather than a plain GObject.
+typedef struct _SSDBusObject SSDBusObject;
+struct _SSDBusObject {
+  GObject   parent_instance; // Unused.
+};
+
+typedef struct _SSDBusObjectClass SSDBusObjectClass;
+struct _SSDBusObjectClass {
+  GObjectClass   parent_class; // Unused.
+};
+
+static guint stats_updated_signal;
+static guint stats_updated_timeout_id = 0;
+
 static GObject *obj = NULL;
 
 // Some more D-Bus bookkeeping.  These variables are global because, if they
@@ -29,6 +46,75 @@ static DBusGProxy *proxy = NULL;
 
 //------------------------------------------------------------------------------
 
+static void
+ss_dbus_object_class_init (SSDBusObjectClass *klass)
+{
+  GType su_types[1];
+  su_types[0] = DBUS_TYPE_G_STRING_VALUE_HASHTABLE;
+
+  stats_updated_signal = g_signal_newv (
+    "stats_updated",
+    G_TYPE_FROM_CLASS (klass),
+    G_SIGNAL_RUN_LAST,
+    NULL, NULL, NULL,
+    g_cclosure_marshal_VOID__BOXED,
+    G_TYPE_NONE,
+    1, su_types);
+}
+
+//------------------------------------------------------------------------------
+
+static GType
+ss_dbus_object_get_type (void)
+{
+  static GType type = 0;
+  if (type == 0) {
+    static const GTypeInfo info = {
+      sizeof (SSDBusObjectClass),
+      NULL,   // base_init
+      NULL,   // base_finalize
+      (GClassInitFunc) ss_dbus_object_class_init,
+      NULL,   // class_finalize
+      NULL,   // class_data
+      sizeof (SSDBusObject),
+      0,      // n_preallocs
+      NULL    // instance_init
+    };
+    type = g_type_register_static (G_TYPE_OBJECT, "SSDBusObjectType", &info, 0);
+  }
+  return type;
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+emit_stats_updated (gpointer data)
+{
+  GHashTable *stats;
+
+  stats_updated_timeout_id = 0;
+  stats = NULL;
+  if (superswitcher_get_stats (obj, &stats, NULL)) {
+    g_signal_emit (obj, stats_updated_signal, 0, stats);
+    g_hash_table_destroy (stats);
+  }
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_dbus_object_note_stats_changed (void)
+{
+  if (obj == NULL || stats_updated_timeout_id != 0) {
+    return;
+  }
+  stats_updated_timeout_id =
+    g_timeout_add (STATS_UPDATED_INTERVAL_MS, emit_stats_updated, NULL);
+}
+
+//------------------------------------------------------------------------------
+
 gboolean
 init_superswitcher_dbus (void)
 {
@@ -66,14 +152,15 @@ init_superswitcher_dbus (void)
     return FALSE;
   }
 
-  // GObjects now serve things, as told by dbus_glib_superswitcher_object_info,
-  // including superswitcher.SuperSwitcher's ShowPopup method.
-  dbus_g_object_type_install_info (G_TYPE_OBJECT,
+  // SSDBusObjects now serve things, as told by
+  // dbus_glib_superswitcher_object_info, including superswitcher.SuperSwitcher's
+  // ShowPopup method and StatsUpdated signal.
+  dbus_g_object_type_install_info (ss_dbus_object_get_type (),
                                    &dbus_glib_superswitcher_object_info);
 
-  // Now register a GObject (which, thanks to the above, serves what we want)
-  // as a D-Bus object.
-  obj = g_object_new (G_TYPE_OBJECT, NULL);
+  // Now register an SSDBusObject (which, thanks to the above, serves what we
+  // want) as a D-Bus object.
+  obj = g_object_new (ss_dbus_object_get_type (), NULL);
   dbus_g_connection_register_g_object (conn, SS_DBUS_PATH, G_OBJECT (obj));
 
   return TRUE;
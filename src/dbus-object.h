@@ -10,6 +10,9 @@
 
 #ifdef HAVE_DBUS_GLIB
 gboolean    init_superswitcher_dbus   (void);
+
+// Schedules a StatsUpdated signal, unless one is already scheduled.
+void        ss_dbus_object_note_stats_changed   (void);
 #endif
 
 #endif
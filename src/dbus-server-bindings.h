@@ -98,6 +98,198 @@ dbus_glib_marshal_superswitcher_BOOLEAN__POINTER (GClosure     *closure,
   g_value_set_boolean (return_value, v_return);
 }
 
+/* BOOLEAN:POINTER,POINTER (/tmp/dbus-binding-tool-c-marshallers.FK95LT:2) */
+extern void dbus_glib_marshal_superswitcher_BOOLEAN__POINTER_POINTER (GClosure     *closure,
+                                                                      GValue       *return_value,
+                                                                      guint         n_param_values,
+                                                                      const GValue *param_values,
+                                                                      gpointer      invocation_hint,
+                                                                      gpointer      marshal_data);
+void
+dbus_glib_marshal_superswitcher_BOOLEAN__POINTER_POINTER (GClosure     *closure,
+                                                          GValue       *return_value,
+                                                          guint         n_param_values,
+                                                          const GValue *param_values,
+                                                          gpointer      invocation_hint,
+                                                          gpointer      marshal_data)
+{
+  typedef gboolean (*GMarshalFunc_BOOLEAN__POINTER_POINTER) (gpointer     data1,
+                                                             gpointer     arg_1,
+                                                             gpointer     arg_2,
+                                                             gpointer     data2);
+  register GMarshalFunc_BOOLEAN__POINTER_POINTER callback;
+  register GCClosure *cc = (GCClosure*) closure;
+  register gpointer data1, data2;
+  gboolean v_return;
+
+  g_return_if_fail (return_value != NULL);
+  g_return_if_fail (n_param_values == 3);
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = g_value_peek_pointer (param_values + 0);
+    }
+  else
+    {
+      data1 = g_value_peek_pointer (param_values + 0);
+      data2 = closure->data;
+    }
+  callback = (GMarshalFunc_BOOLEAN__POINTER_POINTER) (marshal_data ? marshal_data : cc->callback);
+
+  v_return = callback (data1,
+                       g_marshal_value_peek_pointer (param_values + 1),
+                       g_marshal_value_peek_pointer (param_values + 2),
+                       data2);
+
+  g_value_set_boolean (return_value, v_return);
+}
+
+/* BOOLEAN:UINT,POINTER (/tmp/dbus-binding-tool-c-marshallers.FK95LT:3) */
+extern void dbus_glib_marshal_superswitcher_BOOLEAN__UINT_POINTER (GClosure     *closure,
+                                                                   GValue       *return_value,
+                                                                   guint         n_param_values,
+                                                                   const GValue *param_values,
+                                                                   gpointer      invocation_hint,
+                                                                   gpointer      marshal_data);
+void
+dbus_glib_marshal_superswitcher_BOOLEAN__UINT_POINTER (GClosure     *closure,
+                                                       GValue       *return_value,
+                                                       guint         n_param_values,
+                                                       const GValue *param_values,
+                                                       gpointer      invocation_hint,
+                                                       gpointer      marshal_data)
+{
+  typedef gboolean (*GMarshalFunc_BOOLEAN__UINT_POINTER) (gpointer     data1,
+                                                          guint        arg_1,
+                                                          gpointer     arg_2,
+                                                          gpointer     data2);
+  register GMarshalFunc_BOOLEAN__UINT_POINTER callback;
+  register GCClosure *cc = (GCClosure*) closure;
+  register gpointer data1, data2;
+  gboolean v_return;
+
+  g_return_if_fail (return_value != NULL);
+  g_return_if_fail (n_param_values == 3);
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = g_value_peek_pointer (param_values + 0);
+    }
+  else
+    {
+      data1 = g_value_peek_pointer (param_values + 0);
+      data2 = closure->data;
+    }
+  callback = (GMarshalFunc_BOOLEAN__UINT_POINTER) (marshal_data ? marshal_data : cc->callback);
+
+  v_return = callback (data1,
+                       g_marshal_value_peek_uint (param_values + 1),
+                       g_marshal_value_peek_pointer (param_values + 2),
+                       data2);
+
+  g_value_set_boolean (return_value, v_return);
+}
+
+/* BOOLEAN:STRING,POINTER,POINTER (/tmp/dbus-binding-tool-c-marshallers.FK95LT:4) */
+extern void dbus_glib_marshal_superswitcher_BOOLEAN__STRING_POINTER_POINTER (GClosure     *closure,
+                                                                             GValue       *return_value,
+                                                                             guint         n_param_values,
+                                                                             const GValue *param_values,
+                                                                             gpointer      invocation_hint,
+                                                                             gpointer      marshal_data);
+void
+dbus_glib_marshal_superswitcher_BOOLEAN__STRING_POINTER_POINTER (GClosure     *closure,
+                                                                 GValue       *return_value,
+                                                                 guint         n_param_values,
+                                                                 const GValue *param_values,
+                                                                 gpointer      invocation_hint,
+                                                                 gpointer      marshal_data)
+{
+  typedef gboolean (*GMarshalFunc_BOOLEAN__STRING_POINTER_POINTER) (gpointer     data1,
+                                                                    gpointer     arg_1,
+                                                                    gpointer     arg_2,
+                                                                    gpointer     arg_3,
+                                                                    gpointer     data2);
+  register GMarshalFunc_BOOLEAN__STRING_POINTER_POINTER callback;
+  register GCClosure *cc = (GCClosure*) closure;
+  register gpointer data1, data2;
+  gboolean v_return;
+
+  g_return_if_fail (return_value != NULL);
+  g_return_if_fail (n_param_values == 4);
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = g_value_peek_pointer (param_values + 0);
+    }
+  else
+    {
+      data1 = g_value_peek_pointer (param_values + 0);
+      data2 = closure->data;
+    }
+  callback = (GMarshalFunc_BOOLEAN__STRING_POINTER_POINTER) (marshal_data ? marshal_data : cc->callback);
+
+  v_return = callback (data1,
+                       g_marshal_value_peek_string (param_values + 1),
+                       g_marshal_value_peek_pointer (param_values + 2),
+                       g_marshal_value_peek_pointer (param_values + 3),
+                       data2);
+
+  g_value_set_boolean (return_value, v_return);
+}
+
+/* BOOLEAN:UINT,INT,POINTER (/tmp/dbus-binding-tool-c-marshallers.FK95LT:5) */
+extern void dbus_glib_marshal_superswitcher_BOOLEAN__UINT_INT_POINTER (GClosure     *closure,
+                                                                       GValue       *return_value,
+                                                                       guint         n_param_values,
+                                                                       const GValue *param_values,
+                                                                       gpointer      invocation_hint,
+                                                                       gpointer      marshal_data);
+void
+dbus_glib_marshal_superswitcher_BOOLEAN__UINT_INT_POINTER (GClosure     *closure,
+                                                           GValue       *return_value,
+                                                           guint         n_param_values,
+                                                           const GValue *param_values,
+                                                           gpointer      invocation_hint,
+                                                           gpointer      marshal_data)
+{
+  typedef gboolean (*GMarshalFunc_BOOLEAN__UINT_INT_POINTER) (gpointer     data1,
+                                                              guint        arg_1,
+                                                              gint         arg_2,
+                                                              gpointer     arg_3,
+                                                              gpointer     data2);
+  register GMarshalFunc_BOOLEAN__UINT_INT_POINTER callback;
+  register GCClosure *cc = (GCClosure*) closure;
+  register gpointer data1, data2;
+  gboolean v_return;
+
+  g_return_if_fail (return_value != NULL);
+  g_return_if_fail (n_param_values == 4);
+
+  if (G_CCLOSURE_SWAP_DATA (closure))
+    {
+      data1 = closure->data;
+      data2 = g_value_peek_pointer (param_values + 0);
+    }
+  else
+    {
+      data1 = g_value_peek_pointer (param_values + 0);
+      data2 = closure->data;
+    }
+  callback = (GMarshalFunc_BOOLEAN__UINT_INT_POINTER) (marshal_data ? marshal_data : cc->callback);
+
+  v_return = callback (data1,
+                       g_marshal_value_peek_uint (param_values + 1),
+                       g_marshal_value_peek_int (param_values + 2),
+                       g_marshal_value_peek_pointer (param_values + 3),
+                       data2);
+
+  g_value_set_boolean (return_value, v_return);
+}
+
 G_END_DECLS
 
 #endif /* __dbus_glib_marshal_superswitcher_MARSHAL_H__ */
@@ -107,14 +299,21 @@ static const DBusGMethodInfo dbus_glib_superswitcher_methods[] = {
   { (GCallback) superswitcher_hide_popup, dbus_glib_marshal_superswitcher_BOOLEAN__POINTER, 0 },
   { (GCallback) superswitcher_show_popup, dbus_glib_marshal_superswitcher_BOOLEAN__POINTER, 41 },
   { (GCallback) superswitcher_toggle_popup, dbus_glib_marshal_superswitcher_BOOLEAN__POINTER, 82 },
+  { (GCallback) superswitcher_get_stats, dbus_glib_marshal_superswitcher_BOOLEAN__POINTER_POINTER, 125 },
+  { (GCallback) superswitcher_get_trace, dbus_glib_marshal_superswitcher_BOOLEAN__POINTER_POINTER, 183 },
+  { (GCallback) superswitcher_list_windows, dbus_glib_marshal_superswitcher_BOOLEAN__POINTER_POINTER, 237 },
+  { (GCallback) superswitcher_list_workspaces, dbus_glib_marshal_superswitcher_BOOLEAN__POINTER_POINTER, 301 },
+  { (GCallback) superswitcher_activate_window, dbus_glib_marshal_superswitcher_BOOLEAN__UINT_POINTER, 371 },
+  { (GCallback) superswitcher_activate_best_match, dbus_glib_marshal_superswitcher_BOOLEAN__STRING_POINTER_POINTER, 425 },
+  { (GCallback) superswitcher_move_window_to_workspace, dbus_glib_marshal_superswitcher_BOOLEAN__UINT_INT_POINTER, 496 },
 };
 
 const DBusGObjectInfo dbus_glib_superswitcher_object_info = {
   0,
   dbus_glib_superswitcher_methods,
-  3,
-"superswitcher.SuperSwitcher\0HidePopup\0S\0\0superswitcher.SuperSwitcher\0ShowPopup\0S\0\0superswitcher.SuperSwitcher\0TogglePopup\0S\0\0\0",
-"\0",
+  10,
+"superswitcher.SuperSwitcher\0HidePopup\0S\0\0superswitcher.SuperSwitcher\0ShowPopup\0S\0\0superswitcher.SuperSwitcher\0TogglePopup\0S\0\0superswitcher.SuperSwitcher\0GetStats\0S\0stats\0O\0F\0N\0a{sv}\0\0superswitcher.SuperSwitcher\0GetTrace\0S\0trace\0O\0F\0N\0s\0\0superswitcher.SuperSwitcher\0ListWindows\0S\0windows\0O\0F\0N\0aa{sv}\0\0superswitcher.SuperSwitcher\0ListWorkspaces\0S\0workspaces\0O\0F\0N\0aa{sv}\0\0superswitcher.SuperSwitcher\0ActivateWindow\0S\0xid\0I\0u\0\0superswitcher.SuperSwitcher\0ActivateBestMatch\0S\0query\0I\0s\0xid\0O\0F\0N\0u\0\0superswitcher.SuperSwitcher\0MoveWindowToWorkspace\0S\0xid\0I\0u\0workspace\0I\0i\0\0\0",
+"superswitcher.SuperSwitcher\0StatsUpdated\0\0",
 "\0"
 };
 
@@ -0,0 +1,259 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "focushistory.h"
+
+#include "screen.h"
+#include "window.h"
+#include "workspace.h"
+
+//------------------------------------------------------------------------------
+
+SSFocusHistory *
+ss_focus_history_new (SSScreen *screen)
+{
+  SSFocusHistory *history;
+  history = g_new (SSFocusHistory, 1);
+  history->screen = screen;
+  history->windows = g_queue_new ();
+  history->next_focus_stamp = 1;
+  history->is_cycling = FALSE;
+  history->cycle_workspace = NULL;
+  history->cycle_cursor = NULL;
+  history->cycle_serial = 0;
+  history->awaiting_focus = NULL;
+  return history;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_focus_history_free (SSFocusHistory *history)
+{
+  if (history == NULL) {
+    return;
+  }
+  g_queue_free (history->windows);
+  g_free (history);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+move_link_to_front (GQueue *queue, GList *link)
+{
+  if (queue->head == link) {
+    return;
+  }
+  g_queue_unlink (queue, link);
+  g_queue_push_head_link (queue, link);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+move_link_to_back (GQueue *queue, GList *link)
+{
+  if (queue->tail == link) {
+    return;
+  }
+  g_queue_unlink (queue, link);
+  g_queue_push_tail_link (queue, link);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+move_to_front (SSFocusHistory *history, SSWindow *window)
+{
+  window->focus_stamp = history->next_focus_stamp++;
+  move_link_to_front (history->windows, window->mru_link);
+  if ((window->workspace != NULL) && (window->workspace_mru_link != NULL)) {
+    move_link_to_front (window->workspace->mru_windows, window->workspace_mru_link);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// A window that has never been focused goes to the back of the history.
+void
+ss_focus_history_add_window (SSFocusHistory *history, SSWindow *window)
+{
+  g_queue_push_tail (history->windows, window);
+  window->mru_link = history->windows->tail;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_focus_history_remove_window (SSFocusHistory *history, SSWindow *window)
+{
+  if (window->mru_link == NULL) {
+    return;
+  }
+  if (history->awaiting_focus == window) {
+    history->awaiting_focus = NULL;
+  }
+  g_queue_delete_link (history->windows, window->mru_link);
+  window->mru_link = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+// The window keeps its place (by when it was last focused) in the new
+// workspace's history.  This walks the workspace's history, but windows move
+// between workspaces rarely, compared to how often focus changes.
+void
+ss_focus_history_add_window_to_workspace (SSFocusHistory *history, SSWindow *window, SSWorkspace *workspace)
+{
+  GList *i;
+
+  for (i = workspace->mru_windows->head; i; i = i->next) {
+    if (((SSWindow *) i->data)->focus_stamp < window->focus_stamp) {
+      g_queue_insert_before (workspace->mru_windows, i, window);
+      window->workspace_mru_link = i->prev;
+      return;
+    }
+  }
+  g_queue_push_tail (workspace->mru_windows, window);
+  window->workspace_mru_link = workspace->mru_windows->tail;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_focus_history_remove_window_from_workspace (SSFocusHistory *history, SSWindow *window, SSWorkspace *workspace)
+{
+  if (window->workspace_mru_link == NULL) {
+    return;
+  }
+
+  // Keep the cycle's place: the next step forwards goes to whatever came
+  // after the removed window.
+  if (history->cycle_cursor == window->workspace_mru_link) {
+    history->cycle_cursor = window->workspace_mru_link->prev;
+  }
+  g_queue_delete_link (workspace->mru_windows, window->workspace_mru_link);
+  window->workspace_mru_link = NULL;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_focus_history_note_focus (SSFocusHistory *history, SSWindow *window)
+{
+  if ((window == NULL) || (window->mru_link == NULL)) {
+    return;
+  }
+  if (history->is_cycling) {
+    return;
+  }
+
+  if (history->awaiting_focus != NULL) {
+    if (window == history->awaiting_focus) {
+      history->awaiting_focus = NULL;
+    } else if (window->cycle_serial == history->cycle_serial) {
+      // A stale focus change, from a step of the cycle that has since ended.
+      return;
+    } else {
+      // Something else got focused, so the window that the cycle ended on
+      // never will be.
+      history->awaiting_focus = NULL;
+    }
+  }
+
+  move_to_front (history, window);
+}
+
+//------------------------------------------------------------------------------
+
+// Moves a window that has never been focused to the back of the history.
+// Windows that have been focused are left where they are, and are always
+// ahead of those that have not, so seeding the never-focused windows one by
+// one, most likely to be used next first, orders them behind the real focus
+// history.  Unlike a focus, this does not stamp the window, and it is not
+// held off by cycling.
+void
+ss_focus_history_seed (SSFocusHistory *history, SSWindow *window)
+{
+  if ((window == NULL) || (window->mru_link == NULL) || (window->focus_stamp != 0)) {
+    return;
+  }
+  move_link_to_back (history->windows, window->mru_link);
+  if ((window->workspace != NULL) && (window->workspace_mru_link != NULL)) {
+    move_link_to_back (window->workspace->mru_windows, window->workspace_mru_link);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the next window to activate when cycling through the workspace's
+// windows, most recently used first.  The first step (forwards) from the
+// active window goes to the previously used window, just like Alt-Tab.
+SSWindow *
+ss_focus_history_cycle (SSFocusHistory *history, SSWorkspace *workspace, gboolean backwards)
+{
+  GQueue *queue;
+  SSWindow *window;
+
+  queue = workspace->mru_windows;
+  if (queue->length == 0) {
+    return NULL;
+  }
+
+  if (!history->is_cycling || (history->cycle_workspace != workspace)) {
+    history->is_cycling = TRUE;
+    history->cycle_workspace = workspace;
+    history->cycle_serial++;
+    history->awaiting_focus = NULL;
+
+    // A NULL cursor means "just before the head".
+    history->cycle_cursor = NULL;
+    window = (SSWindow *) queue->head->data;
+    if (window == history->screen->active_window) {
+      history->cycle_cursor = queue->head;
+      window->cycle_serial = history->cycle_serial;
+    }
+  }
+
+  if (backwards) {
+    if ((history->cycle_cursor != NULL) && (history->cycle_cursor->prev != NULL)) {
+      history->cycle_cursor = history->cycle_cursor->prev;
+    } else {
+      history->cycle_cursor = queue->tail;
+    }
+  } else {
+    if ((history->cycle_cursor != NULL) && (history->cycle_cursor->next != NULL)) {
+      history->cycle_cursor = history->cycle_cursor->next;
+    } else {
+      history->cycle_cursor = queue->head;
+    }
+  }
+
+  window = (SSWindow *) history->cycle_cursor->data;
+  window->cycle_serial = history->cycle_serial;
+  return window;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_focus_history_end_cycle (SSFocusHistory *history)
+{
+  SSWindow *window;
+
+  if (!history->is_cycling) {
+    return;
+  }
+  history->is_cycling = FALSE;
+
+  if (history->cycle_cursor != NULL) {
+    window = (SSWindow *) history->cycle_cursor->data;
+    move_to_front (history, window);
+    if (window != history->screen->active_window) {
+      history->awaiting_focus = window;
+    }
+  }
+  history->cycle_workspace = NULL;
+  history->cycle_cursor = NULL;
+}
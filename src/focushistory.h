@@ -0,0 +1,52 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_FOCUSHISTORY_H
+#define SUPERSWITCHER_FOCUSHISTORY_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+
+// The focus history is the order in which windows were most recently used
+// (focused), kept both globally and per workspace.  Each SSWindow holds the
+// GList links of its place in those queues, so that moving a window to the
+// front, or stepping to the next window when cycling, is O(1).
+struct _SSFocusHistory {
+  SSScreen *   screen;
+
+  // Every SSWindow, most recently focused first.
+  GQueue *   windows;
+
+  // Each focus is stamped with the next value of this counter.
+  guint   next_focus_stamp;
+
+  // Cycling (e.g. Super+Tab, Super+Tab, ...) steps a cursor through a
+  // workspace's history without re-ordering it, even though each step
+  // activates (and so focuses) a window.  The window that the cycle ends on
+  // is then moved to the front.
+  gboolean        is_cycling;
+  SSWorkspace *   cycle_workspace;
+  GList *         cycle_cursor;
+  guint           cycle_serial;
+
+  // The focus changes that a cycle caused can arrive after the cycle has
+  // ended.  Until the window that the cycle ended on is reported as focused,
+  // focus changes to the other windows visited by that cycle are ignored.
+  SSWindow *   awaiting_focus;
+};
+
+SSFocusHistory *   ss_focus_history_new    (SSScreen *screen);
+void               ss_focus_history_free   (SSFocusHistory *history);
+
+void   ss_focus_history_add_window                    (SSFocusHistory *history, SSWindow *window);
+void   ss_focus_history_remove_window                 (SSFocusHistory *history, SSWindow *window);
+void   ss_focus_history_add_window_to_workspace       (SSFocusHistory *history, SSWindow *window, SSWorkspace *workspace);
+void   ss_focus_history_remove_window_from_workspace  (SSFocusHistory *history, SSWindow *window, SSWorkspace *workspace);
+
+void        ss_focus_history_note_focus   (SSFocusHistory *history, SSWindow *window);
+void        ss_focus_history_seed         (SSFocusHistory *history, SSWindow *window);
+SSWindow *  ss_focus_history_cycle        (SSFocusHistory *history, SSWorkspace *workspace, gboolean backwards);
+void        ss_focus_history_end_cycle    (SSFocusHistory *history);
+
+#endif
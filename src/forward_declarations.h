@@ -5,7 +5,11 @@
 #define SUPERSWITCHER_FORWARD_DECLARATIONS_H
 
 typedef struct _SSDragAndDrop    SSDragAndDrop;
+typedef struct _SSFocusHistory   SSFocusHistory;
+typedef struct _SSHistogram      SSHistogram;
+typedef struct _SSIdleStats      SSIdleStats;
 typedef struct _SSScreen         SSScreen;
+typedef struct _SSSearch         SSSearch;
 typedef struct _SSWindow         SSWindow;
 typedef struct _SSWorkspace      SSWorkspace;
 typedef struct _SSXinerama       SSXinerama;
@@ -24,11 +28,30 @@ gboolean   superswitcher_hide_popup     (void *, GError **);
 gboolean   superswitcher_show_popup     (void *, GError **);
 gboolean   superswitcher_toggle_popup   (void *, GError **);
 
+#ifdef HAVE_DBUS_GLIB
+#include <glib/garray.h>
+#include <glib/ghash.h>
+gboolean   superswitcher_get_stats      (void *, GHashTable **, GError **);
+gboolean   superswitcher_get_trace      (void *, char **, GError **);
+gboolean   superswitcher_list_windows      (void *, GPtrArray **, GError **);
+gboolean   superswitcher_list_workspaces   (void *, GPtrArray **, GError **);
+gboolean   superswitcher_activate_window            (void *, guint, GError **);
+gboolean   superswitcher_activate_best_match        (void *, const char *, guint *, GError **);
+gboolean   superswitcher_move_window_to_workspace   (void *, guint, int, GError **);
+#endif
+
 #ifdef HAVE_XCOMPOSITE
 extern gboolean show_window_thumbnails;
+extern int thumbnail_prerender_budget_ms;
+extern int thumbnail_cache_size;
+extern int thumbnail_rerender_interval_ms;
 typedef struct _SSThumbnailer SSThumbnailer;
 #endif
 
 extern gboolean window_manager_uses_viewports;
+extern gboolean use_fuzzy_search;
+extern gboolean print_idle_stats;
+extern gboolean print_startup_profile;
+extern gboolean record_trace;
 
 #endif
@@ -0,0 +1,130 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "idlestats.h"
+
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "window.h"
+
+//------------------------------------------------------------------------------
+
+gboolean print_idle_stats = FALSE;
+
+static GSource *wakeup_counter = NULL;
+static guint num_wakeups = 0;
+static GTimer *hidden_timer = NULL;
+static double cpu_seconds_at_start = 0.0;
+static guint num_window_signals_at_start = 0;
+
+static SSIdleStats last = { 0.0, 0.0, 0, 0 };
+
+//------------------------------------------------------------------------------
+
+// The main loop calls every source's prepare function once per iteration, so
+// a source that never dispatches is a cheap way to count wakeups.
+static gboolean
+wakeup_counter_prepare (GSource *source, gint *timeout)
+{
+  num_wakeups++;
+  *timeout = -1;
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+wakeup_counter_check (GSource *source)
+{
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+wakeup_counter_dispatch (GSource *source, GSourceFunc callback, gpointer data)
+{
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+static GSourceFuncs wakeup_counter_funcs = {
+  wakeup_counter_prepare,
+  wakeup_counter_check,
+  wakeup_counter_dispatch,
+  NULL
+};
+
+//------------------------------------------------------------------------------
+
+static double
+get_cpu_seconds (void)
+{
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != 0) {
+    return 0.0;
+  }
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+//------------------------------------------------------------------------------
+
+// Called when the popup is hidden.
+void
+ss_idle_stats_start (void)
+{
+  if (wakeup_counter != NULL) {
+    return;
+  }
+  if (hidden_timer == NULL) {
+    hidden_timer = g_timer_new ();
+  }
+  g_timer_start (hidden_timer);
+  cpu_seconds_at_start = get_cpu_seconds ();
+  num_window_signals_at_start = ss_window_get_update_stats ()->num_signals;
+  num_wakeups = 0;
+
+  wakeup_counter = g_source_new (&wakeup_counter_funcs, sizeof (GSource));
+  g_source_attach (wakeup_counter, NULL);
+}
+
+//------------------------------------------------------------------------------
+
+// Called when the popup is about to be shown.
+void
+ss_idle_stats_stop (void)
+{
+  if (wakeup_counter == NULL) {
+    return;
+  }
+  g_source_destroy (wakeup_counter);
+  g_source_unref (wakeup_counter);
+  wakeup_counter = NULL;
+
+  last.seconds_hidden = g_timer_elapsed (hidden_timer, NULL);
+  last.cpu_seconds = get_cpu_seconds () - cpu_seconds_at_start;
+  last.num_wakeups = num_wakeups;
+  last.num_window_signals =
+    ss_window_get_update_stats ()->num_signals - num_window_signals_at_start;
+
+  if (print_idle_stats && last.seconds_hidden > 0.0) {
+    fprintf (stderr, "superswitcher: hidden for %.1fs: %.2f wakeups/s, "
+        "%.3f%% CPU, %u window signals\n",
+        last.seconds_hidden,
+        last.num_wakeups / last.seconds_hidden,
+        100.0 * last.cpu_seconds / last.seconds_hidden,
+        last.num_window_signals);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+const SSIdleStats *
+ss_idle_stats_get_last (void)
+{
+  return &last;
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_IDLESTATS_H
+#define SUPERSWITCHER_IDLESTATS_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+
+// What superswitcher cost while the popup was hidden, which is most of the
+// time.  A "wakeup" is one iteration of the main loop.
+struct _SSIdleStats {
+  double   seconds_hidden;
+  double   cpu_seconds;
+  guint    num_wakeups;
+  guint    num_window_signals;
+};
+
+void                  ss_idle_stats_start      (void);
+void                  ss_idle_stats_stop       (void);
+const SSIdleStats *   ss_idle_stats_get_last   (void);
+
+#endif
@@ -10,6 +10,12 @@
 #include "string.h"
 
 #include "draganddrop.h"
+#include "idlestats.h"
+#include "stats.h"
+#include "trace.h"
+#ifdef HAVE_XCOMPOSITE
+#include "thumbnailer.h"
+#endif
 #include "window.h"
 #include "workspace.h"
 #include "xinerama.h"
@@ -20,27 +26,24 @@ static void
 action_change_active_window_by_delta (Popup *popup, int delta, gboolean also_bring_active_window,
   guint32 time, gboolean also_warp_pointer_if_necessary)
 {
-  GList *window_list;
-  GList *i;
+  GPtrArray *windows;
   SSWindow *aw;
   SSWindow *window;
-  SSWindow *previous_window;
-  gboolean should_activate_next_window;
   int n, num_windows;
 
   if (popup->screen->active_workspace == NULL) {
     return;
   }
 
-  window_list = popup->screen->active_workspace->windows;
+  windows = popup->screen->active_workspace->windows;
   aw = popup->screen->active_window;
-  num_windows = g_list_length (window_list);
+  num_windows = windows->len;
   if (aw == NULL) {
     if (num_windows > 0) {
       if (delta == +1) {
-        window = (SSWindow *) (g_list_first (window_list))->data;
+        window = (SSWindow *) g_ptr_array_index (windows, 0);
       } else {
-        window = (SSWindow *) (g_list_last  (window_list))->data;
+        window = (SSWindow *) g_ptr_array_index (windows, num_windows - 1);
       }
       ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
     }
@@ -51,56 +54,36 @@ action_change_active_window_by_delta (Popup *popup, int delta, gboolean also_bri
     return;
   }
 
-  if (also_bring_active_window) {
-    n = g_list_index (window_list, aw) + delta;
-    if (n == -1) {
-      n = num_windows - 1;
-    }
-    else if (n == num_windows) {
-      n = 0;
-    }
-    ss_workspace_reorder_window (popup->screen->active_workspace, aw, n);
-    gtk_widget_queue_draw (popup->window);
+  // The active window might be on another workspace (e.g. if it is sticky).
+  if ((aw->workspace != popup->screen->active_workspace) ||
+      (aw->index_in_workspace < 0)) {
     return;
   }
 
-  should_activate_next_window = FALSE;
-
-  previous_window = (SSWindow *) (g_list_last (window_list))->data;
-  for (i = window_list; i; i = i->next) {
-    window = (SSWindow *) i->data;
-
-    if (should_activate_next_window) {
-      ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
-      return;
-    }
-
-    if (window == aw) {
-      if (delta == +1) {
-        should_activate_next_window = TRUE;
-      } else if (delta == -1) {
-        ss_window_activate_window (previous_window, time, also_warp_pointer_if_necessary);
-        return;
-      } else {
-        g_assert_not_reached ();
-      }
-    }
-
-    previous_window = window;
+  n = aw->index_in_workspace + delta;
+  if (n == -1) {
+    n = num_windows - 1;
+  }
+  else if (n == num_windows) {
+    n = 0;
   }
 
-  if (should_activate_next_window) {
-    window = (SSWindow *) (g_list_first (window_list))->data;
-    ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
+  if (also_bring_active_window) {
+    ss_workspace_reorder_window (popup->screen->active_workspace, aw, n);
+    gtk_widget_queue_draw (popup->window);
+    return;
   }
+
+  window = (SSWindow *) g_ptr_array_index (windows, n);
+  ss_window_activate_window (window, time, also_warp_pointer_if_necessary);
 }
 
 //------------------------------------------------------------------------------
 
 static void
-action_change_active_window_by_stacking_order (Popup *popup, gboolean backwards, guint32 time)
+action_change_active_window_by_focus_history (Popup *popup, gboolean backwards, guint32 time)
 {
-  ss_screen_activate_next_window_in_stacking_order (popup->screen, backwards, time);
+  ss_screen_activate_next_window_in_focus_history (popup->screen, backwards, time);
 }
 
 //------------------------------------------------------------------------------
@@ -160,6 +143,7 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
   SSWindow *window;
   GList *i;
   GList *j;
+  guint k;
 
   int num_workspaces_deleted;
   gboolean active_workspace_has_been_seen;
@@ -203,9 +187,9 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
         wnck_workspace_to_activate = wnck_workspace_to_move_to;
       }
 
-      if (g_list_length (workspace->windows) > 0) {
-        for (j = workspace->windows; j; j = j->next) {
-          window = (SSWindow *) j->data;
+      if (workspace->windows->len > 0) {
+        for (k = 0; k < workspace->windows->len; k++) {
+          window = (SSWindow *) g_ptr_array_index (workspace->windows, k);
           wnck_windows_to_move = g_list_append
             (wnck_windows_to_move, window->wnck_window);
           wnck_workspaces_to_move_to = g_list_append
@@ -224,7 +208,7 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
     // Delete only the active workspace, and only if it is empty.
 
     if (popup->screen->active_workspace != NULL &&
-        g_list_length (popup->screen->active_workspace->windows) == 0) {
+        popup->screen->active_workspace->windows->len == 0) {
       active_workspace_has_been_seen = FALSE;
       wnck_workspace_to_move_to = NULL;
       for (i = workspaces; i; i = i->next) {
@@ -234,8 +218,8 @@ action_delete_workspace_if_empty (Popup *popup, gboolean all_not_just_current_wo
           active_workspace_has_been_seen = TRUE;
         }
         else if (active_workspace_has_been_seen) {
-          for (j = workspace->windows; j; j = j->next) {
-            window = (SSWindow *) j->data;
+          for (k = 0; k < workspace->windows->len; k++) {
+            window = (SSWindow *) g_ptr_array_index (workspace->windows, k);
             wnck_windows_to_move = g_list_append
               (wnck_windows_to_move, window->wnck_window);
             wnck_workspaces_to_move_to = g_list_append
@@ -283,7 +267,7 @@ action_close_active_window (Popup *popup, gboolean all_windows_in_workspace, gui
 {
   SSWorkspace *workspace;
   SSWindow *window;
-  GList *i;
+  guint i;
 
   if (all_windows_in_workspace) {
     workspace = popup->screen->active_workspace;
@@ -291,8 +275,8 @@ action_close_active_window (Popup *popup, gboolean all_windows_in_workspace, gui
       return;
     }
 
-    for (i = workspace->windows; i; i = i->next) {
-      window = (SSWindow *) i->data;
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
       wnck_window_close (window->wnck_window, time);
     }
 
@@ -314,7 +298,7 @@ action_window_toggle_maximize (Popup *popup, gboolean all_windows_in_workspace,
   SSWorkspace *workspace;
   SSWindow *window;
   gboolean all_windows_are_maximized;
-  GList *i;
+  guint i;
 
   if (all_windows_in_workspace) {
     workspace = popup->screen->active_workspace;
@@ -323,8 +307,8 @@ action_window_toggle_maximize (Popup *popup, gboolean all_windows_in_workspace,
     }
 
     all_windows_are_maximized = TRUE;
-    for (i = workspace->windows; i; i = i->next) {
-      window = (SSWindow *) i->data;
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
       if (! wnck_window_is_maximized (window->wnck_window)) {
         all_windows_are_maximized = FALSE;
         break;
@@ -332,13 +316,13 @@ action_window_toggle_maximize (Popup *popup, gboolean all_windows_in_workspace,
     }
 
     if (all_windows_are_maximized) {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
+      for (i = 0; i < workspace->windows->len; i++) {
+        window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
         wnck_window_unmaximize (window->wnck_window);
       }
     } else {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
+      for (i = 0; i < workspace->windows->len; i++) {
+        window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
         wnck_window_maximize (window->wnck_window);
       }
     }
@@ -365,7 +349,7 @@ action_window_toggle_minimize (Popup *popup, gboolean all_windows_in_workspace,
   SSWorkspace *workspace;
   SSWindow *window;
   gboolean all_windows_are_minimized;
-  GList *i;
+  guint i;
 
   if (all_windows_in_workspace) {
     workspace = popup->screen->active_workspace;
@@ -374,8 +358,8 @@ action_window_toggle_minimize (Popup *popup, gboolean all_windows_in_workspace,
     }
 
     all_windows_are_minimized = TRUE;
-    for (i = workspace->windows; i; i = i->next) {
-      window = (SSWindow *) i->data;
+    for (i = 0; i < workspace->windows->len; i++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
       if (! wnck_window_is_minimized (window->wnck_window)) {
         all_windows_are_minimized = FALSE;
         break;
@@ -383,13 +367,13 @@ action_window_toggle_minimize (Popup *popup, gboolean all_windows_in_workspace,
     }
 
     if (all_windows_are_minimized) {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
+      for (i = 0; i < workspace->windows->len; i++) {
+        window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
         wnck_window_unminimize (window->wnck_window, time);
       }
     } else {
-      for (i = workspace->windows; i; i = i->next) {
-        window = (SSWindow *) i->data;
+      for (i = 0; i < workspace->windows->len; i++) {
+        window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
         wnck_window_minimize (window->wnck_window);
       }
     }
@@ -449,7 +433,7 @@ on_active_workspace_changed (SSScreen *screen, gpointer data)
 static void
 on_window_opened (SSScreen *screen, SSWindow *window, gpointer data)
 {
-  if (window == NULL) {
+  if ((window == NULL) || (window->widget == NULL)) {
     return;
   }
   gtk_widget_show_all (window->widget);
@@ -468,7 +452,7 @@ on_window_closed (SSScreen *screen, SSWindow *window, gpointer data)
 static void
 on_workspace_created (SSScreen *screen, SSWorkspace *workspace, gpointer data)
 {
-  GList *i;
+  guint i;
   SSWindow *window;
   Popup *popup;
   popup = (Popup *) data;
@@ -479,8 +463,8 @@ on_workspace_created (SSScreen *screen, SSWorkspace *workspace, gpointer data)
     if (popup->owc_also_bring_active_window) {
       if (popup->owc_all_not_just_current_window) {
         if (screen->active_workspace != NULL) {
-          for (i = screen->active_workspace->windows; i; i = i->next) {
-            window = (SSWindow *) i->data;
+          for (i = 0; i < screen->active_workspace->windows->len; i++) {
+            window = (SSWindow *) g_ptr_array_index (screen->active_workspace->windows, i);
             wnck_window_move_to_workspace (
               window->wnck_window,
               workspace->wnck_workspace);
@@ -559,8 +543,8 @@ on_leave_notify_event (GtkWidget *widget, GdkEvent *event, gpointer data)
 static gboolean
 on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
 {
-#ifdef HAVE_GTK_2_8
   Popup *popup;
+#ifdef HAVE_GTK_2_8
   SSScreen *screen;
   SSDragAndDrop *dnd;
   cairo_t *c;
@@ -572,13 +556,32 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
   GtkAllocation *a;
   int oldx0, oldx1, oldy0, oldy1, oldhalfheight;
   int newx0, newx1, newy0, newy1;
+  GPtrArray *visible_windows;
   int n;
+  int k;
   int y;
+#endif
   popup = (Popup *) data;
+
+  // The popup's first expose after popup_show is when it is first drawn.
+  if (popup->show_start_us != 0) {
+    ss_stats_record_latency (SS_LATENCY_POPUP_SHOW, popup->show_start_us);
+    if (record_trace) {
+      ss_trace_record ("popup_show until drawn", popup->show_start_us);
+    }
+    popup->show_start_us = 0;
+    popup->screen->xinerama->num_round_trips_last_show =
+        popup->screen->xinerama->num_round_trips_since_show;
+  }
+
+#ifdef HAVE_GTK_2_8
   screen = popup->screen;
 
   dnd = screen->drag_and_drop;
-  if ((dnd->is_dragging) && (dnd->drag_workspace != NULL)) {
+  // There is nothing to draw from if the dragged window has lost its widget
+  // (see ss_window_dematerialize).
+  if ((dnd->is_dragging) && (dnd->drag_workspace != NULL) &&
+      ((dnd->drag_start_window == NULL) || (dnd->drag_start_window->widget != NULL))) {
     c = gdk_cairo_create (popup->window->window);
     cairo_set_line_width (c, 2.0);
 
@@ -604,10 +607,21 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
       newx1 = +3 + a->x + a->width;
       a = &(dnd->drag_workspace->window_container->allocation);
       y = a->y;
-      n = g_list_length (dnd->drag_workspace->windows);
+      // Only the visible rows are laid out, so the marker goes just above the
+      // visible row at new_window_index (a logical index), or just below the
+      // last visible row for the end position.
+      visible_windows = dnd->drag_workspace->visible_windows;
+      n = visible_windows->len;
       if (n != 0) {
         if (dnd->new_window_index != -1) {
-          y += (a->height * dnd->new_window_index) / n;
+          k = dnd->new_window_index - dnd->drag_workspace->first_visible_index;
+          if (k >= n) {
+            a = &(((SSWindow *) g_ptr_array_index (visible_windows, n - 1))->widget->allocation);
+            y = a->y + a->height + WINDOW_ROW_SPACING / 2;
+          } else {
+            a = &(((SSWindow *) g_ptr_array_index (visible_windows, MAX (k, 0)))->widget->allocation);
+            y = a->y - WINDOW_ROW_SPACING / 2;
+          }
         }
       } else {
         y += oldhalfheight;
@@ -677,6 +691,11 @@ search_widget_create (Popup *popup)
   gtk_box_pack_start (GTK_BOX (box), popup->search_num_matches_label, FALSE, FALSE, 0);
 
   gtk_widget_show_all (box);
+
+  // The search box is only shown once the user starts typing.
+  gtk_widget_set_no_show_all (popup->search_container, TRUE);
+  gtk_widget_hide (popup->search_container);
+  popup->search_is_shown = FALSE;
 }
 
 //------------------------------------------------------------------------------
@@ -810,11 +829,13 @@ popup_create (SSScreen *screen)
   GtkWidget *frame;
   GtkWidget *vbox;
   GtkWidget *align;
+  guint64 trace_start_us;
 
-  ss_screen_update_search (screen, "");
-
+  trace_start_us = SS_TRACE_BEGIN ();
   popup = g_new (Popup, 1);
   popup->screen = screen;
+  popup->is_shown = FALSE;
+  popup->show_start_us = 0;
 
   popup->search_text_label = NULL;
   popup->search_num_matches_label = NULL;
@@ -876,8 +897,15 @@ popup_create (SSScreen *screen)
 
   gtk_box_pack_start (GTK_BOX (vbox), gtk_hseparator_new (), FALSE, FALSE, 0);
   button_bar_create (popup, vbox);
-
-  gtk_widget_show_all (popup->window);
+  search_widget_create (popup);
+
+  // Show everything but the toplevel, and realize the toplevel, so that
+  // popup_show only has to map it.
+  gtk_widget_show_all (frame);
+  gtk_widget_realize (popup->window);
+  ss_screen_prepare_for_hide (screen);
+  ss_idle_stats_start ();
+  SS_TRACE_END ("popup_create", trace_start_us);
   return popup;
 }
 
@@ -886,7 +914,9 @@ popup_create (SSScreen *screen)
 void
 popup_free (Popup *popup)
 {
-  ss_screen_update_wnck_windows_in_stacking_order (popup->screen);
+  guint64 trace_start_us;
+  trace_start_us = SS_TRACE_BEGIN ();
+  popup_hide (popup);
   gtk_container_remove (GTK_CONTAINER (popup->screen_container),
     popup->screen->widget);
 
@@ -905,6 +935,66 @@ popup_free (Popup *popup)
 
   gtk_widget_destroy (popup->window);
   g_free (popup);
+  SS_TRACE_END ("popup_free", trace_start_us);
+}
+
+//------------------------------------------------------------------------------
+
+void
+popup_show (Popup *popup)
+{
+  if (popup->is_shown) {
+    return;
+  }
+
+  popup->show_start_us = ss_stats_now_us ();
+  ss_idle_stats_stop ();
+  ss_screen_prepare_for_show (popup->screen);
+
+  // Reset whatever the last show left behind: the search, and its widget.
+  ss_screen_update_search (popup->screen, "");
+  gtk_label_set_text (GTK_LABEL (popup->search_text_label), "");
+  gtk_label_set_text (GTK_LABEL (popup->search_num_matches_label), "");
+  if (popup->search_is_shown) {
+    gtk_widget_hide (popup->search_container);
+    popup->search_is_shown = FALSE;
+  }
+
+#ifdef HAVE_XCOMPOSITE
+  if (show_window_thumbnails) {
+    ss_thumbnailer_set_popup_is_shown (TRUE);
+  }
+#endif
+  gtk_widget_show (popup->window);
+  popup->is_shown = TRUE;
+  if (record_trace) {
+    ss_trace_record ("popup_show", popup->show_start_us);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+popup_hide (Popup *popup)
+{
+  guint64 trace_start_us;
+  if (!popup->is_shown) {
+    return;
+  }
+
+  trace_start_us = SS_TRACE_BEGIN ();
+  ss_screen_end_window_cycle (popup->screen);
+  gtk_widget_hide (popup->window);
+  popup->is_shown = FALSE;
+  popup->show_start_us = 0;
+#ifdef HAVE_XCOMPOSITE
+  if (show_window_thumbnails) {
+    ss_thumbnailer_set_popup_is_shown (FALSE);
+  }
+#endif
+  ss_screen_prepare_for_hide (popup->screen);
+  ss_idle_stats_start ();
+  SS_TRACE_END ("popup_hide", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -959,7 +1049,7 @@ popup_on_key_press (Popup *popup, Display *x_display, XKeyEvent *x_key_event)
     action_delete_workspace_if_empty (popup, shifted | ctrled, time);
   }
   else if (keysym == XK_Tab) {
-    action_change_active_window_by_stacking_order (popup, shifted, time);
+    action_change_active_window_by_focus_history (popup, shifted, time);
   }
   else if (keysym == XK_Escape) {
     action_close_active_window (popup, ctrled, time);
@@ -1007,7 +1097,7 @@ popup_on_key_press (Popup *popup, Display *x_display, XKeyEvent *x_key_event)
     action_activate_next_window (popup, shifted, time);
   }
   else if (keysym == XK_BackSpace) {
-    if (popup->search_text_label != NULL) {
+    if (popup->search_is_shown) {
       old_search_text = gtk_label_get_text (GTK_LABEL (popup->search_text_label));
       n = strlen (old_search_text);
       if (n > 0) {
@@ -1021,8 +1111,9 @@ popup_on_key_press (Popup *popup, Display *x_display, XKeyEvent *x_key_event)
   }
   else {
     if (key_string[0] != '\0') {
-      if (popup->search_text_label == NULL) {
-        search_widget_create (popup);
+      if (!popup->search_is_shown) {
+        gtk_widget_show (popup->search_container);
+        popup->search_is_shown = TRUE;
         gtk_widget_queue_draw (popup->window);
       }
       old_search_text = gtk_label_get_text (GTK_LABEL (popup->search_text_label));
@@ -20,6 +20,14 @@ struct _Popup
   GtkWidget *   search_text_label;
   GtkWidget *   search_num_matches_label;
 
+  // The popup is built (and realized) once, and then shown and hidden,
+  // rather than being re-built on every Super key press.
+  gboolean   is_shown;
+  gboolean   search_is_shown;
+
+  // When popup_show was called, until the popup is drawn, or 0.
+  guint64   show_start_us;
+
   gulong   signal_id_active_window_changed;
   gulong   signal_id_active_workspace_changed;
   gulong   signal_id_window_closed;
@@ -37,6 +45,9 @@ struct _Popup
 Popup *   popup_create   (SSScreen *screen);
 void      popup_free     (Popup *popup_window);
 
+void   popup_show   (Popup *popup_window);
+void   popup_hide   (Popup *popup_window);
+
 void   popup_on_key_press   (Popup *popup_window, Display *x_display, XKeyEvent *x_key_event);
 
 #endif
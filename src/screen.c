@@ -11,14 +11,26 @@
 #endif
 
 #include "draganddrop.h"
+#include "focushistory.h"
+#include "search.h"
+#include "startupprofile.h"
+#include "stats.h"
+#include "trace.h"
 #include "window.h"
 #include "workspace.h"
 #include "xinerama.h"
 
+#ifdef HAVE_XCOMPOSITE
+#include "thumbnailer.h"
+#endif
+
 //------------------------------------------------------------------------------
 
 #define NUMBER_OF_F_KEYS 12
 
+// How many of the windows that existed at startup are added per idle callback.
+#define STARTUP_BATCH_SIZE 32
+
 static char *f_keys[] = {
   "F1", "F2", "F3", "F4", "F5", "F6",
   "F7", "F8", "F9", "F10", "F11", "F12"
@@ -43,30 +55,77 @@ static guint gconf_focus_mode_notify_id = 0;
 static SSWindow *
 get_ss_window_from_wnck_window (SSScreen *screen, WnckWindow *wnck_window)
 {
-  gulong xid;
-  SSWorkspace *workspace;
   SSWindow *window;
-  GList *i;
-  GList *j;
 
   if (wnck_window == NULL) {
     return NULL;
   }
 
-  xid = wnck_window_get_xid (wnck_window);
+  window = (SSWindow *) g_hash_table_lookup (screen->windows_by_wnck_window, wnck_window);
 
-  // Walk through the list of list of windows, matching by X ID.
-  for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
-      if (xid == wnck_window_get_xid (window->wnck_window)) {
-        return window;
-      }
+  // Windows that are not (currently) on any workspace, such as those that
+  // have been pinned, are indexed but are not otherwise shown.
+  if ((window == NULL) || (window->workspace == NULL)) {
+    return NULL;
+  }
+  return window;
+}
+
+//------------------------------------------------------------------------------
+
+SSWindow *
+ss_screen_get_window_by_xid (SSScreen *screen, gulong xid)
+{
+  SSWindow *window;
+
+  window = (SSWindow *) g_hash_table_lookup (screen->windows_by_xid, GUINT_TO_POINTER (xid));
+  if ((window == NULL) || (window->workspace == NULL)) {
+    return NULL;
+  }
+  return window;
+}
+
+//------------------------------------------------------------------------------
+
+static GdkFilterReturn
+filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
+{
+  SSScreen *screen;
+  SSWindow *window;
+  XEvent *x_event;
+
+  screen = SS_SCREEN (data);
+  x_event = (XEvent *) gdk_xevent;
+  if (ss_xinerama_is_frame_extents_notify (screen->xinerama, x_event)) {
+    window = (SSWindow *) g_hash_table_lookup (screen->windows_by_xid,
+        GUINT_TO_POINTER (x_event->xproperty.window));
+    if (window != NULL) {
+      window->frame_extents_are_valid = FALSE;
     }
   }
+  return GDK_FILTER_CONTINUE;
+}
 
-  return NULL;
+//------------------------------------------------------------------------------
+
+static void
+index_window (SSScreen *screen, SSWindow *window)
+{
+  g_hash_table_insert (screen->windows_by_xid,
+    GUINT_TO_POINTER (wnck_window_get_xid (window->wnck_window)), window);
+  g_hash_table_insert (screen->windows_by_wnck_window,
+    window->wnck_window, window);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+unindex_window (SSScreen *screen, SSWindow *window)
+{
+  g_hash_table_remove (screen->windows_by_xid,
+    GUINT_TO_POINTER (wnck_window_get_xid (window->wnck_window)));
+  g_hash_table_remove (screen->windows_by_wnck_window,
+    window->wnck_window);
 }
 
 //------------------------------------------------------------------------------
@@ -132,7 +191,7 @@ void
 ss_screen_change_active_workspace_to (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport,
   gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time)
 {
-  GList *i;
+  guint i;
   SSWindow *window;
   SSWorkspace *workspace;
 
@@ -140,8 +199,8 @@ ss_screen_change_active_workspace_to (SSScreen *screen, WnckWorkspace *wnck_work
     workspace = get_ss_workspace_from_wnck_workspace (screen, wnck_workspace, viewport);
     if (all_not_just_current_window) {
       if (screen->active_workspace != NULL) {
-        for (i = screen->active_workspace->windows; i; i = i->next) {
-          window = (SSWindow *) i->data;
+        for (i = 0; i < screen->active_workspace->windows->len; i++) {
+          window = (SSWindow *) g_ptr_array_index (screen->active_workspace->windows, i);
           ss_window_move_to_workspace (window, workspace);
         }
       }
@@ -201,68 +260,98 @@ ss_screen_change_active_workspace (SSScreen *screen, int n, gboolean also_bring_
 
 //------------------------------------------------------------------------------
 
+#ifdef HAVE_XCOMPOSITE
 static void
-update_search (SSScreen *screen, SSWindow *window, gchar** terms)
+add_window_if_frame_extents_are_stale (gpointer key, gpointer value, gpointer data)
 {
-  gboolean matched;
-  char* title;
-  gchar* term;
-  int t;
-
-  title = (char *) wnck_window_get_name (window->wnck_window);
-  if (title != NULL) {
-    matched = TRUE;
-    title = g_ascii_strdown (title, strlen (title));
-    t = 0;
-    while (terms[t] != NULL) {
-      term = terms[t];
-      t++;
-      if (strlen(term) == 0) {
-        continue;
-      }
-      if (g_strrstr (title, term) == NULL) {
-        matched = FALSE;
-        break;
-      }
-    }
-    g_free (title);
-  } else {
-    matched = FALSE;
-  }
-
-  ss_window_set_sensitive (window, matched);
-  if (matched) {
-    screen->num_search_matches++;
+  SSWindow *window;
+  window = (SSWindow *) value;
+  if (!window->frame_extents_are_valid && (window->workspace != NULL)) {
+    g_ptr_array_add ((GPtrArray *) data, window);
   }
 }
+#endif
 
 //------------------------------------------------------------------------------
 
+// Called just before the popup is shown, to fetch (in one burst) whatever X
+// state drawing the popup will need.
 void
-ss_screen_update_search (SSScreen *screen, const char *query)
+ss_screen_prepare_for_show (SSScreen *screen)
 {
-  char *normalized_query;
-  gchar** terms;
-  SSWorkspace *workspace;
-  SSWindow *window;
   GList *i;
-  GList *j;
+#ifdef HAVE_XCOMPOSITE
+  GPtrArray *stale_windows;
+#endif
 
-  normalized_query = g_ascii_strdown (query, strlen (query));
-  terms = g_strsplit (normalized_query, " ", 0);
-  screen->num_search_matches = 0;
+  screen->xinerama->num_round_trips_since_show = 0;
 
+  // Build the widgets of the windows that are (now) visible.
   for (i = screen->workspaces; i; i = i->next) {
-    workspace = (SSWorkspace *) i->data;
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
+    ss_workspace_update_visible_windows ((SSWorkspace *) i->data);
+  }
 
-      update_search (screen, window, terms);
-    }
+  // Catch up with whatever happened while we were hidden.
+  screen->is_suspended = FALSE;
+  ss_window_set_updates_suspended (FALSE);
+  if (screen->stacking_order_is_stale) {
+    ss_screen_update_stacking_order (screen);
   }
 
-  g_strfreev (terms);
-  g_free (normalized_query);
+#ifdef HAVE_XCOMPOSITE
+  // Only the thumbnails need the frame extents.
+  if (show_window_thumbnails) {
+    stale_windows = g_ptr_array_new ();
+    g_hash_table_foreach (screen->windows_by_xid,
+        add_window_if_frame_extents_are_stale, stale_windows);
+    ss_xinerama_prefetch_frame_extents (screen->xinerama, stale_windows);
+    g_ptr_array_free (stale_windows, TRUE);
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+// Nobody can see the popup, so there is no point in keeping its widgets (or
+// the stacking order, which only the popup uses) up to date.
+void
+ss_screen_prepare_for_hide (SSScreen *screen)
+{
+  screen->is_suspended = TRUE;
+  ss_window_set_updates_suspended (TRUE);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_screen_update_search (SSScreen *screen, const char *query)
+{
+  guint64 start_us;
+  start_us = ss_stats_now_us ();
+  screen->num_search_matches = ss_search_update (screen->search, query);
+  ss_stats_record_latency (SS_LATENCY_SEARCH_UPDATE, start_us);
+  if (record_trace) {
+    ss_trace_record ("ss_screen_update_search", start_us);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Searches for query as if it were typed into the popup, but without showing
+// the popup, and returns the best match (see ss_search_best_match), or NULL.
+SSWindow *
+ss_screen_find_best_match (SSScreen *screen, const char *query)
+{
+  // The fuzzy search ranks ties by stacking order, which is not kept up to
+  // date while the screen is suspended.
+  if (screen->stacking_order_is_stale) {
+    ss_screen_update_stacking_order (screen);
+  }
+  // Likewise, while the popup is hidden, renames are queued (see
+  // ss_window_flush_updates) rather than applied to the folded titles.
+  ss_window_flush_updates ();
+  ss_screen_update_search (screen, query);
+  return ss_search_best_match (screen->search);
 }
 
 //------------------------------------------------------------------------------
@@ -273,7 +362,7 @@ ss_screen_activate_next_window (SSScreen *screen, gboolean backwards, guint32 ti
   SSWorkspace *workspace;
   SSWindow *window;
   GList *i;
-  GList *j;
+  guint j;
 
   SSWindow *first_sensitive_window;
   SSWindow *previous_sensitive_window;
@@ -283,6 +372,13 @@ ss_screen_activate_next_window (SSScreen *screen, gboolean backwards, guint32 ti
 
   gboolean also_warp_pointer_if_necessary;
 
+  // With --fuzzy-search, Return walks the matches best first.
+  window = ss_search_next_ranked_match (screen->search, backwards);
+  if (window != NULL) {
+    ss_window_activate_workspace_and_window (window, time, TRUE);
+    return;
+  }
+
   first_sensitive_window    = NULL;
   previous_sensitive_window = NULL;
   should_activate_last_sensitive_window = FALSE;
@@ -305,8 +401,8 @@ ss_screen_activate_next_window (SSScreen *screen, gboolean backwards, guint32 ti
         should_activate_next_sensitive_window = TRUE;
       }
     }
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
+    for (j = 0; j < workspace->windows->len; j++) {
+      window = (SSWindow *) g_ptr_array_index (workspace->windows, j);
 
       if (screen->active_window != NULL) {
         found_active_window = (window == screen->active_window);
@@ -358,121 +454,37 @@ ss_screen_activate_next_window (SSScreen *screen, gboolean backwards, guint32 ti
 //------------------------------------------------------------------------------
 
 void
-ss_screen_activate_next_window_in_stacking_order (SSScreen *screen, gboolean backwards, guint32 time)
+ss_screen_activate_next_window_in_focus_history (SSScreen *screen, gboolean backwards, guint32 time)
 {
-  WnckWindow *active_wnck_window;
-  WnckWindow *wnck_window;
-  gboolean ww_is_aww;
-  WnckWorkspace *active_wnck_workspace;
-  WnckWorkspace *wnck_workspace;
-  int active_workspace_id;
-  int workspace_id;
-  GList *i;
-  int num_windows;
-
-  WnckWindow *first_eligible_wnck_window;
-  WnckWindow *previous_eligible_wnck_window;
-  gboolean should_activate_last_eligible_wnck_window;
-  gboolean should_activate_next_eligible_wnck_window;
-  
-  gboolean also_warp_pointer_if_necessary;
-  also_warp_pointer_if_necessary = TRUE;
+  SSWindow *window;
 
-  num_windows = g_list_length (screen->active_workspace->windows);
-  if (num_windows == 0) {
+  if (screen->active_workspace == NULL) {
     return;
   }
-
-  // TODO - this is probably an ugly hack that's exposed to a potential
-  // race condition.  A better way to go about this would be to suppress
-  // the window_stacking_change signal, I suppose.
-  // For example, if a window gets opened in between setting this flag
-  // and in the event handler on_window_stacking_changed, then the
-  // window_stacking_order list will be copied at the wrong point,
-  // possibly.
-  screen->should_ignore_next_window_stacking_change = TRUE;
-
-  first_eligible_wnck_window    = NULL;
-  previous_eligible_wnck_window = NULL;
-  should_activate_last_eligible_wnck_window = FALSE;
-  should_activate_next_eligible_wnck_window = FALSE;
-
-  if (screen->active_window != NULL) {
-    active_wnck_window = screen->active_window->wnck_window;
-  } else {
-    active_wnck_window = NULL;
+  window = ss_focus_history_cycle (screen->focus_history,
+    screen->active_workspace, backwards);
+  if (window != NULL) {
+    ss_window_activate_window (window, time, TRUE);
   }
-  active_wnck_workspace = wnck_screen_get_active_workspace (screen->wnck_screen);
-  active_workspace_id = (active_wnck_workspace != NULL) ? wnck_workspace_get_number (active_wnck_workspace) : -1;
-
-  // Note that wnck_windows_in_stacking_order is in bottom-to-top
-  // order, so that if we're searching forwards (just like Alt-Tab)
-  // then we want the previous_eligible_wnck_window.  This is the
-  // opposite ordering than in ss_screen_activate_next_window.
-  for (i = screen->wnck_windows_in_stacking_order; i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
-    wnck_workspace = wnck_window_get_workspace (wnck_window);
-    workspace_id = (wnck_workspace != NULL) ? wnck_workspace_get_number (wnck_workspace) : -1;
-
-    if (workspace_id != active_workspace_id) {
-      continue;
-    }
-
-    if (active_wnck_window != NULL) {
-      ww_is_aww = (wnck_window_get_xid (wnck_window) ==
-        wnck_window_get_xid (active_wnck_window));
-    } else {
-      ww_is_aww = FALSE;
-    }
-
-    // We've found the active window, and we're searching forwards.
-    if (!backwards && ww_is_aww) {
-      if (previous_eligible_wnck_window == NULL) {
-        should_activate_last_eligible_wnck_window = TRUE;
-      } else {
-        ss_window_activate_window (get_ss_window_from_wnck_window (
-          screen, previous_eligible_wnck_window), time,
-          also_warp_pointer_if_necessary);
-        return;
-      }
-    }
-
-    if (should_activate_next_eligible_wnck_window) {
-      ss_window_activate_window (get_ss_window_from_wnck_window (
-        screen, wnck_window), time, also_warp_pointer_if_necessary);
-      return;
-    }
-
-    previous_eligible_wnck_window = wnck_window;
-
-    if (first_eligible_wnck_window == NULL) {
-      first_eligible_wnck_window = wnck_window;
-    }
+}
 
-    // We've found the active window, and we're searching backwards.
-    if (backwards && ww_is_aww) {
-      should_activate_next_eligible_wnck_window = TRUE;
-    }
-  }
+//------------------------------------------------------------------------------
 
-  if (active_wnck_window == NULL) {
-    if (backwards) {
-      should_activate_next_eligible_wnck_window = TRUE;
-    } else {
-      should_activate_last_eligible_wnck_window = TRUE;
-    }
-  }
+// Called when the popup is hidden, which ends any Alt-Tab-style cycling.
+void
+ss_screen_end_window_cycle (SSScreen *screen)
+{
+  ss_focus_history_end_cycle (screen->focus_history);
+}
 
-  if (should_activate_next_eligible_wnck_window) {
-    ss_window_activate_window (get_ss_window_from_wnck_window (
-      screen, first_eligible_wnck_window), time, also_warp_pointer_if_necessary);
-    return;
-  }
+//------------------------------------------------------------------------------
 
-  if (should_activate_last_eligible_wnck_window) {
-    ss_window_activate_window (get_ss_window_from_wnck_window (
-      screen, previous_eligible_wnck_window), time, also_warp_pointer_if_necessary);
-    return;
+static void
+invalidate_all_mini_maps (SSScreen *screen)
+{
+  GList *i;
+  for (i = screen->workspaces; i; i = i->next) {
+    ss_workspace_invalidate_mini_map ((SSWorkspace *) i->data);
   }
 }
 
@@ -489,6 +501,7 @@ update_workspace_titles (SSScreen *screen)
     workspace = (SSWorkspace *) i->data;
     workspace->title = (j < NUMBER_OF_F_KEYS) ? f_keys[j] : "";
   }
+  invalidate_all_mini_maps (screen);
 }
 
 //------------------------------------------------------------------------------
@@ -505,10 +518,23 @@ update_for_active_window (SSScreen *screen)
   if (screen->active_window != window) {
     if (screen->active_window != NULL) {
       ss_window_set_selected (screen->active_window, FALSE);
+      ss_workspace_invalidate_mini_map (screen->active_window->workspace);
     }
     screen->active_window = window;
     if (screen->active_window != NULL) {
       ss_window_set_selected (screen->active_window, TRUE);
+      ss_workspace_invalidate_mini_map (screen->active_window->workspace);
+      ss_workspace_scroll_to_window (screen->active_window->workspace, screen->active_window);
+    }
+    ss_focus_history_note_focus (screen->focus_history, window);
+
+    // If some other window became active first, then the activation was
+    // (probably) refused, and is not measured.
+    if (screen->activating_window != NULL) {
+      if (screen->activating_window == window) {
+        ss_stats_record_latency (SS_LATENCY_WINDOW_ACTIVATION, screen->activation_start_us);
+      }
+      screen->activating_window = NULL;
     }
   }
 }
@@ -519,6 +545,9 @@ static void
 update_for_active_workspace (SSScreen *screen)
 {
   WnckWorkspace *wnck_workspace;
+  SSWorkspace *old_active_workspace;
+
+  old_active_workspace = screen->active_workspace;
 
   if (window_manager_uses_viewports) {
     wnck_workspace = wnck_screen_get_workspace (screen->wnck_screen, 0);
@@ -536,6 +565,10 @@ update_for_active_workspace (SSScreen *screen)
       screen->active_workspace = NULL;
     }
   }
+  if (screen->active_workspace != old_active_workspace) {
+    ss_workspace_invalidate_mini_map (old_active_workspace);
+    ss_workspace_invalidate_mini_map (screen->active_workspace);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -571,59 +604,142 @@ add_window_to_screen (SSScreen *screen, WnckWindow *wnck_window)
   }
   workspace = ss_screen_get_workspace_for_wnck_window (screen, wnck_window);
   window = ss_window_new (workspace, wnck_window);
+  index_window (screen, window);
+  ss_focus_history_add_window (screen->focus_history, window);
   if (wnck_window_is_active (wnck_window)) {
     if (screen->active_window != NULL) {
       ss_window_set_selected (screen->active_window, FALSE);
+      ss_workspace_invalidate_mini_map (screen->active_window->workspace);
     }
     screen->active_window = window;
     if (screen->active_window != NULL) {
       ss_window_set_selected (screen->active_window, TRUE);
+      ss_workspace_invalidate_mini_map (screen->active_window->workspace);
     }
   }
   ss_workspace_add_window (workspace, window);
+  if (screen->active_window == window) {
+    ss_focus_history_note_focus (screen->focus_history, window);
+  }
   return window;
 }
 
 //------------------------------------------------------------------------------
 
 static void
-update_window_label_width (SSScreen *screen)
+update_font_metrics (SSScreen *screen)
 {
   PangoContext *context;
   PangoFontMetrics *metrics;
-  int width, char_width;
-  SSWorkspace *workspace;
-  SSWindow *window;
-  GList *i;
-  GList *j;
 
   context = gtk_widget_get_pango_context (screen->widget);
   metrics = pango_context_get_metrics (context,
     screen->widget->style->font_desc, NULL);
-  char_width = PANGO_PIXELS (pango_font_metrics_get_approximate_char_width (metrics));
+  screen->font_char_width = MAX (1,
+    PANGO_PIXELS (pango_font_metrics_get_approximate_char_width (metrics)));
+  screen->font_row_height = PANGO_PIXELS (pango_font_metrics_get_ascent (metrics) +
+                                          pango_font_metrics_get_descent (metrics));
   pango_font_metrics_unref (metrics);
+}
+
+//------------------------------------------------------------------------------
+
+// Works out how wide (in chars) the window labels should be, and how many rows
+// of windows a workspace shows, from the (cached) font metrics, the monitor
+// sizes and the number of workspaces.  The labels are only touched if their
+// width really changed, and then only those that have widgets: the others get
+// the new width when they are materialized.
+static void
+update_window_label_width (SSScreen *screen)
+{
+  int width, height, row_height, num_rows;
+  gboolean width_changed, num_rows_changed;
+  SSWorkspace *workspace;
+  GList *i;
+  guint j;
+
+  if (screen->font_char_width == 0) {
+    update_font_metrics (screen);
+  }
 
   // The widget should be slightly less wide than the screen.  This is
-  // completely arbitrary, but it looks OK on my machine.
-  width = (screen->xinerama->minimum_width * 3 / 4) / screen->num_workspaces;
+  // completely arbitrary, but it looks OK on my machine.  The popup is
+  // centred on the screen rather than on any one monitor, so we size it for
+  // the narrowest monitor.
+  width = (screen->xinerama->minimum_width * 3 / 4) / MAX (1, screen->num_workspaces);
   // Subtract off a bit for the icon, and the remainder is for the label.
   width -= 30;
   // convert from pixels to chars.
-  width /= char_width;
+  width /= screen->font_char_width;
 
+  // Similarly, the columns of windows should be slightly less tall than the
+  // screen, less a bit for the workspace headers and the button bar.  A row
+  // is as tall as the taller of its icon (or thumbnail) and its label.
+#ifdef HAVE_XCOMPOSITE
+  row_height = MAX (screen->font_row_height, show_window_thumbnails ? THUMBNAIL_SIZE : 16);
+#else
+  row_height = MAX (screen->font_row_height, 16);
+#endif
+  height = (screen->xinerama->minimum_height * 3 / 4) - 120;
+  num_rows = MAX (3, height / (row_height + WINDOW_ROW_SPACING));
+
+  width_changed = (width != screen->label_max_width_chars);
+  num_rows_changed = (num_rows != screen->max_window_rows);
+  if (!width_changed && !num_rows_changed) {
+    return;
+  }
   screen->label_max_width_chars = width;
+  screen->max_window_rows = num_rows;
 
   for (i = screen->workspaces; i; i = i->next) {
     workspace = (SSWorkspace *) i->data;
-    for (j = workspace->windows; j; j = j->next) {
-      window = (SSWindow *) j->data;
-      ss_window_update_label_max_width_chars (window);
+    if (width_changed) {
+      for (j = 0; j < workspace->visible_windows->len; j++) {
+        ss_window_update_label_max_width_chars (
+          (SSWindow *) g_ptr_array_index (workspace->visible_windows, j));
+      }
+    }
+    if (num_rows_changed && !screen->is_suspended) {
+      ss_workspace_update_visible_windows (workspace);
     }
   }
 }
 
 //------------------------------------------------------------------------------
 
+// A theme or font change invalidates the cached font metrics.
+static void
+on_style_set (GtkWidget *widget, GtkStyle *previous_style, gpointer data)
+{
+  SSScreen *screen;
+  screen = (SSScreen *) data;
+  screen->font_char_width = 0;
+  update_window_label_width (screen);
+}
+
+//------------------------------------------------------------------------------
+
+// Called when RandR changes the screen size, or (with gtk+ 2.14) when a
+// monitor is plugged in or unplugged.  The label widths depend on the
+// narrowest monitor, so we only recompute them if the monitors really changed.
+static void
+on_monitors_changed (GdkScreen *gdk_screen, gpointer data)
+{
+  SSScreen *screen;
+  screen = (SSScreen *) data;
+
+  if (!ss_xinerama_update (screen->xinerama)) {
+    return;
+  }
+  screen->screen_width  = gdk_screen_get_width (gdk_screen);
+  screen->screen_height = gdk_screen_get_height (gdk_screen);
+  screen->screen_aspect = (double) screen->screen_height / (double) screen->screen_width;
+  update_window_label_width (screen);
+  invalidate_all_mini_maps (screen);
+}
+
+//------------------------------------------------------------------------------
+
 #ifdef HAVE_WNCK_2_19_3_1
 static void
 on_viewports_changed (WnckScreen *wnck_screen, gpointer data)
@@ -632,12 +748,15 @@ on_viewports_changed (WnckScreen *wnck_screen, gpointer data)
   SSWindow *window;
   WnckWindow *wnck_window;
   GList *i;
+  guint64 trace_start_us;
   screen = (SSScreen *) data;
   if (!window_manager_uses_viewports) {
     return;
   }
+  trace_start_us = SS_TRACE_BEGIN ();
   // TODO - don't segfault (via a bad widget) when the number of viewports change
   update_for_active_workspace (screen);
+  invalidate_all_mini_maps (screen);
   for (i = wnck_screen_get_windows (screen->wnck_screen); i; i = i->next) {
     wnck_window = (WnckWindow *) i->data;
     window = get_ss_window_from_wnck_window (screen, wnck_window);
@@ -647,6 +766,7 @@ on_viewports_changed (WnckScreen *wnck_screen, gpointer data)
     }
   }
   g_signal_emit (screen, active_workspace_changed_signal, 0, NULL);
+  SS_TRACE_END ("on_viewports_changed", trace_start_us);
 }
 #endif
 
@@ -660,9 +780,12 @@ on_active_window_changed (WnckScreen *wnck_screen, gpointer data)
 #endif
 {
   SSScreen *screen;
+  guint64 trace_start_us;
+  trace_start_us = SS_TRACE_BEGIN ();
   screen = (SSScreen *) data;
   update_for_active_window (screen);
   g_signal_emit (screen, active_window_changed_signal, 0, NULL);
+  SS_TRACE_END ("on_active_window_changed", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -675,9 +798,12 @@ on_active_workspace_changed (WnckScreen *wnck_screen, gpointer data)
 #endif
 {
   SSScreen *screen;
+  guint64 trace_start_us;
+  trace_start_us = SS_TRACE_BEGIN ();
   screen = (SSScreen *) data;
   update_for_active_workspace (screen);
   g_signal_emit (screen, active_workspace_changed_signal, 0, NULL);
+  SS_TRACE_END ("on_active_workspace_changed", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -687,26 +813,38 @@ on_window_closed (WnckScreen *wnck_screen, WnckWindow *wnck_window, gpointer dat
 {
   SSScreen *screen;
   SSWindow *window;
-  WnckWorkspace *wnck_workspace;
-  int n;
+  guint64 trace_start_us;
 
+  trace_start_us = SS_TRACE_BEGIN ();
   screen = (SSScreen *) data;
-  window = get_ss_window_from_wnck_window (screen, wnck_window);
+  if (screen->populate_idle_id != 0) {
+    g_queue_remove (screen->pending_wnck_windows, wnck_window);
+  }
+  // Look in the index directly (rather than via get_ss_window_from_wnck_window)
+  // so that windows without a workspace are also freed.
+  window = (SSWindow *) g_hash_table_lookup (screen->windows_by_wnck_window, wnck_window);
   if (window == NULL) {
+    SS_TRACE_END ("on_window_closed", trace_start_us);
     return;
   }
-  wnck_workspace = wnck_window_get_workspace (wnck_window);
-  if (wnck_workspace != NULL) {
-    n = wnck_workspace_get_number (wnck_workspace);
-    ss_workspace_remove_window (ss_screen_get_nth_workspace (screen, n), window);
+  unindex_window (screen, window);
+  ss_search_invalidate (screen->search);
+  g_ptr_array_remove (screen->windows_in_stacking_order, window);
+  if (window->workspace != NULL) {
+    ss_workspace_remove_window (window->workspace, window);
   }
 
   if (screen->active_window == window) {
     screen->active_window = NULL;
   }
+  if (screen->activating_window == window) {
+    screen->activating_window = NULL;
+  }
 
+  ss_focus_history_remove_window (screen->focus_history, window);
   g_signal_emit (screen, window_closed_signal, 0, window);
   ss_window_free (window);
+  SS_TRACE_END ("on_window_closed", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -716,44 +854,103 @@ on_window_opened (WnckScreen *wnck_screen, WnckWindow *wnck_window, gpointer dat
 {
   SSScreen *screen;
   SSWindow *window;
+  guint64 trace_start_us;
 
+  trace_start_us = SS_TRACE_BEGIN ();
   screen = (SSScreen *) data;
   window = add_window_to_screen (screen, wnck_window);
-  if (window == NULL) {
-    return;
+  if (window != NULL) {
+    ss_search_invalidate (screen->search);
+    g_signal_emit (screen, window_opened_signal, 0, window);
   }
-
-  g_signal_emit (screen, window_opened_signal, 0, window);
+  SS_TRACE_END ("on_window_opened", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
 
+// Brings windows_in_stacking_order up to date with libwnck's stacking order.
+// This walks libwnck's list once, but only writes (and re-ranks) from the
+// lowest window whose position actually changed: raising one window only
+// touches the windows above its old position.  Likewise, only the mini-maps of
+// the workspaces whose windows were restacked are re-drawn.
 void
-ss_screen_update_wnck_windows_in_stacking_order (SSScreen *screen)
+ss_screen_update_stacking_order (SSScreen *screen)
 {
-  WnckWindow *wnck_window;
+  GPtrArray *order;
+  SSWindow *window;
+  SSWindow *old_window;
   GList *i;
+  guint n, old_len;
+  guint first_change;
 
-  if (screen->wnck_windows_in_stacking_order != NULL) {
-    g_list_free (screen->wnck_windows_in_stacking_order);
-    screen->wnck_windows_in_stacking_order = NULL;
-  }
-
-  // Make a copy of wnck_screen_get_windows_stacked (screen->wnck_screen),
-  // filtering out those windows that we do not show.
+  order = screen->windows_in_stacking_order;
+  old_len = order->len;
+  n = 0;
+  first_change = G_MAXUINT;
   for (i = wnck_screen_get_windows_stacked (screen->wnck_screen); i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
-    if (wnck_window_is_skip_pager (wnck_window)) {
+    window = get_ss_window_from_wnck_window (screen, (WnckWindow *) i->data);
+    if (window == NULL) {
       continue;
     }
+    if (n < order->len) {
+      old_window = (SSWindow *) g_ptr_array_index (order, n);
+      if (old_window != window) {
+        g_ptr_array_index (order, n) = window;
+        first_change = MIN (first_change, n);
+        ss_workspace_invalidate_mini_map (old_window->workspace);
+        ss_workspace_invalidate_mini_map (window->workspace);
+      }
+    } else {
+      g_ptr_array_add (order, window);
+      ss_workspace_invalidate_mini_map (window->workspace);
+    }
+    n++;
+  }
 
-    screen->wnck_windows_in_stacking_order = g_list_append
-      (screen->wnck_windows_in_stacking_order, wnck_window);
+  // The ranks count down from the top, so if the number of windows changed
+  // then every rank changes.
+  if (n != old_len) {
+    g_ptr_array_set_size (order, n);
+    first_change = 0;
+  }
+  screen->stacking_order_is_stale = FALSE;
+  if (first_change == G_MAXUINT) {
+    return;
   }
 
-  for (i = screen->wnck_windows_in_stacking_order; i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
+  for (; first_change < n; first_change++) {
+    window = (SSWindow *) g_ptr_array_index (order, first_change);
+    window->stacking_rank = n - 1 - first_change;
   }
+  screen->workspace_stacking_orders_are_stale = TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the given workspace's windows, in bottom-to-top stacking order.  The
+// returned array is owned by the workspace.
+GPtrArray *
+ss_screen_get_stacking_order_for_workspace (SSScreen *screen, SSWorkspace *workspace)
+{
+  SSWorkspace *w;
+  SSWindow *window;
+  GList *i;
+  guint j;
+
+  if (screen->workspace_stacking_orders_are_stale) {
+    for (i = screen->workspaces; i; i = i->next) {
+      w = (SSWorkspace *) i->data;
+      g_ptr_array_set_size (w->windows_in_stacking_order, 0);
+    }
+    for (j = 0; j < screen->windows_in_stacking_order->len; j++) {
+      window = (SSWindow *) g_ptr_array_index (screen->windows_in_stacking_order, j);
+      if (window->workspace != NULL) {
+        g_ptr_array_add (window->workspace->windows_in_stacking_order, window);
+      }
+    }
+    screen->workspace_stacking_orders_are_stale = FALSE;
+  }
+  return workspace->windows_in_stacking_order;
 }
 
 //------------------------------------------------------------------------------
@@ -762,14 +959,15 @@ static void
 on_window_stacking_changed (WnckScreen *wnck_screen, gpointer data)
 {
   SSScreen *screen;
+  guint64 trace_start_us;
+  trace_start_us = SS_TRACE_BEGIN ();
   screen = (SSScreen *) data;
-
-  if (screen->should_ignore_next_window_stacking_change) {
-    screen->should_ignore_next_window_stacking_change = FALSE;
-    return;
+  if (screen->is_suspended) {
+    screen->stacking_order_is_stale = TRUE;
+  } else {
+    ss_screen_update_stacking_order (screen);
   }
-
-  ss_screen_update_wnck_windows_in_stacking_order (screen);
+  SS_TRACE_END ("on_window_stacking_changed", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -798,7 +996,9 @@ on_workspace_created (WnckScreen *wnck_screen, WnckWorkspace *wnck_workspace, gp
 {
   SSScreen *screen;
   SSWorkspace *workspace;
+  guint64 trace_start_us;
 
+  trace_start_us = SS_TRACE_BEGIN ();
   screen = (SSScreen *) data;
   screen->num_workspaces = wnck_screen_get_workspace_count (wnck_screen);
   workspace = add_workspace_to_screen (screen, wnck_workspace, 0);
@@ -808,6 +1008,7 @@ on_workspace_created (WnckScreen *wnck_screen, WnckWorkspace *wnck_workspace, gp
   update_workspace_titles (screen);
   g_signal_emit (screen, workspace_created_signal, 0, workspace);
   gtk_widget_queue_draw (gtk_widget_get_toplevel (screen->widget));
+  SS_TRACE_END ("on_workspace_created", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -817,11 +1018,16 @@ on_workspace_destroyed (WnckScreen *wnck_screen, WnckWorkspace *wnck_workspace,
 {
   SSScreen *screen;
   SSWorkspace *workspace;
+  guint64 trace_start_us;
 
+  trace_start_us = SS_TRACE_BEGIN ();
   screen = (SSScreen *) data;
   screen->num_workspaces -= 1;
   workspace = get_ss_workspace_from_wnck_workspace (screen, wnck_workspace, 0);
   screen->workspaces = g_list_remove (screen->workspaces, workspace);
+  if (screen->focus_history->cycle_workspace == workspace) {
+    ss_focus_history_end_cycle (screen->focus_history);
+  }
 
   update_window_label_width (screen);
   update_workspace_titles (screen);
@@ -829,6 +1035,7 @@ on_workspace_destroyed (WnckScreen *wnck_screen, WnckWorkspace *wnck_workspace,
   gtk_container_remove (GTK_CONTAINER (screen->widget), workspace->widget);
   ss_workspace_free (workspace);
   gtk_widget_queue_draw (gtk_widget_get_toplevel (screen->widget));
+  SS_TRACE_END ("on_workspace_destroyed", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -983,6 +1190,65 @@ get_viewport_count (WnckScreen *wnck_screen)
 
 //------------------------------------------------------------------------------
 
+// Called once every window that existed at startup has been added.
+static void
+finish_populating (SSScreen *screen)
+{
+  guint i;
+
+  ss_screen_update_stacking_order (screen);
+
+  // Windows that have not been focused since startup are ordered by the
+  // stacking order (the top-most window being the most recently used),
+  // behind any focus changes seen while populating (e.g. from Super+Tab).
+  for (i = screen->windows_in_stacking_order->len; i > 0; i--) {
+    ss_focus_history_seed (screen->focus_history,
+      (SSWindow *) g_ptr_array_index (screen->windows_in_stacking_order, i - 1));
+  }
+
+  ss_startup_profile_mark ("windows");
+  ss_startup_profile_finish ();
+}
+
+//------------------------------------------------------------------------------
+
+// Adds up to STARTUP_BATCH_SIZE of the windows that existed at startup.  This
+// runs at idle priority, so that X events (such as Super+Tab) and D-Bus
+// calls are handled between batches.
+static gboolean
+populate_in_idle (gpointer data)
+{
+  SSScreen *screen;
+  SSWindow *window;
+  int i;
+  guint64 trace_start_us;
+
+  trace_start_us = SS_TRACE_BEGIN ();
+  screen = (SSScreen *) data;
+  for (i = 0; i < STARTUP_BATCH_SIZE; i++) {
+    if (g_queue_is_empty (screen->pending_wnck_windows)) {
+      break;
+    }
+    window = add_window_to_screen (screen,
+      WNCK_WINDOW (g_queue_pop_head (screen->pending_wnck_windows)));
+    if (window != NULL) {
+      g_signal_emit (screen, window_opened_signal, 0, window);
+    }
+  }
+  ss_search_invalidate (screen->search);
+  screen->num_populate_batches++;
+  SS_TRACE_END ("populate_in_idle", trace_start_us);
+
+  if (!g_queue_is_empty (screen->pending_wnck_windows)) {
+    return TRUE;
+  }
+  screen->populate_idle_id = 0;
+  finish_populating (screen);
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
 SSScreen *
 ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window)
 {
@@ -993,6 +1259,7 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
 
   wnck_screen_force_update (wnck_screen);
   window_manager_uses_viewports = does_window_manager_use_viewports (wnck_screen);
+  ss_startup_profile_mark ("wnck_screen_force_update");
 
   screen = (SSScreen *) g_object_new (SS_TYPE_SCREEN, NULL);
   screen->wnck_screen = wnck_screen;
@@ -1009,19 +1276,36 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
     ? get_viewport_count (wnck_screen)
     : wnck_screen_get_workspace_count (wnck_screen);
 
+  screen->windows_by_xid = g_hash_table_new (g_direct_hash, g_direct_equal);
+  screen->windows_by_wnck_window = g_hash_table_new (g_direct_hash, g_direct_equal);
+
   screen->active_window = NULL;
+  screen->activating_window = NULL;
+  screen->activation_start_us = 0;
   screen->active_workspace = NULL;
   screen->active_workspace_id = -1;
 
-  screen->wnck_windows_in_stacking_order = NULL;
-  screen->should_ignore_next_window_stacking_change = FALSE;
-  ss_screen_update_wnck_windows_in_stacking_order (screen);
+  screen->windows_in_stacking_order = g_ptr_array_new ();
+  screen->workspace_stacking_orders_are_stale = FALSE;
+  // Until the popup is first shown (see ss_screen_prepare_for_show), the
+  // windows are only modelled, without any widgets.
+  screen->is_suspended = TRUE;
+  screen->stacking_order_is_stale = FALSE;
 
+  screen->focus_history = ss_focus_history_new (screen);
+  screen->pending_wnck_windows = g_queue_new ();
+  screen->populate_idle_id = 0;
+  screen->num_populate_batches = 0;
+
+  screen->search = ss_search_new (screen);
   screen->num_search_matches = 0;
 
   screen->drag_and_drop = ss_draganddrop_new (screen);
 
   screen->label_max_width_chars = 256;
+  screen->max_window_rows = G_MAXINT;
+  screen->font_char_width = 0;
+  screen->font_row_height = 0;
   update_window_label_width (screen);
 
 #ifndef HAVE_GTK_2_11
@@ -1043,13 +1327,29 @@ ss_screen_new (WnckScreen *wnck_screen, Display *x_display, Window x_root_window
     }
   }
   update_workspace_titles (screen);
+  ss_startup_profile_mark ("workspaces");
 
+  // The existing windows are added later, in batches (see populate_in_idle).
   wnck_windows = wnck_screen_get_windows (wnck_screen);
   for (; wnck_windows; wnck_windows = wnck_windows->next) {
-    add_window_to_screen (screen, WNCK_WINDOW (wnck_windows->data));
+    g_queue_push_tail (screen->pending_wnck_windows, wnck_windows->data);
   }
+  screen->populate_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+      populate_in_idle, screen, NULL);
 
   // Listen for new workspaces, and new windows
+  gdk_window_add_filter (NULL, filter_func, screen);
+  g_signal_connect (G_OBJECT (screen->widget), "style-set",
+    G_CALLBACK (on_style_set),
+    screen);
+  g_signal_connect (G_OBJECT (gdk_screen_get_default ()), "size-changed",
+    G_CALLBACK (on_monitors_changed),
+    screen);
+#ifdef HAVE_GTK_2_14
+  g_signal_connect (G_OBJECT (gdk_screen_get_default ()), "monitors-changed",
+    G_CALLBACK (on_monitors_changed),
+    screen);
+#endif
   g_signal_connect (G_OBJECT (wnck_screen), "active_window_changed",
     G_CALLBACK (on_active_window_changed),
     screen);
@@ -34,19 +34,58 @@ struct _SSScreen {
   GList *   workspaces;
   int       num_workspaces;
 
+  // Every SSWindow that we know about, keyed by its X ID and by its
+  // WnckWindow, so that finding the SSWindow for a libwnck signal does not
+  // mean walking every workspace's list of windows.
+  GHashTable *   windows_by_xid;
+  GHashTable *   windows_by_wnck_window;
+
   SSWindow *      active_window;
   SSWorkspace *   active_workspace;
   int             active_workspace_id;
 
-  GList *    wnck_windows_in_stacking_order;
-  gboolean   should_ignore_next_window_stacking_change;
+  // The window that ss_window_activate_window last asked to be activated,
+  // until it is, and when it was asked (see SS_LATENCY_WINDOW_ACTIVATION).
+  SSWindow *   activating_window;
+  guint64      activation_start_us;
+
+  // Every SSWindow that is on a workspace, in bottom-to-top stacking order.
+  // Each SSWorkspace also has a view of just its own windows, which is
+  // rebuilt (lazily) when the global order or the workspace membership
+  // changes (see ss_screen_get_stacking_order_for_workspace).
+  GPtrArray *   windows_in_stacking_order;
+  gboolean      workspace_stacking_orders_are_stale;
+
+  // While the popup is hidden, the screen is suspended: stacking changes are
+  // only noted, and applied by ss_screen_prepare_for_show.
+  gboolean   is_suspended;
+  gboolean   stacking_order_is_stale;
+
+  SSFocusHistory *   focus_history;
 
-  int   num_search_matches;
+  // The windows that existed at startup are added a batch at a time, from an
+  // idle callback, so that superswitcher can respond (e.g. to Super+Tab, with
+  // whichever windows are ready) before they have all been added.
+  GQueue *   pending_wnck_windows;
+  guint      populate_idle_id;
+  guint      num_populate_batches;
+
+  SSSearch *   search;
+  int          num_search_matches;
 
   SSDragAndDrop *   drag_and_drop;
 
   int   label_max_width_chars;
 
+  // The most rows of windows that a workspace shows at once (see
+  // ss_workspace_update_visible_windows).
+  int   max_window_rows;
+
+  // The font metrics that the label width and the number of rows are derived
+  // from, cached until the style changes.  A char width of 0 means stale.
+  int   font_char_width;
+  int   font_row_height;
+
 #ifndef HAVE_GTK_2_11
   GtkTooltips *   tooltips;
 #endif
@@ -63,16 +102,22 @@ GType        ss_screen_get_type   (void);
 SSScreen *   ss_screen_new        (WnckScreen *wnck_screen, Display *x_display, Window x_root_window);
 
 SSWorkspace *   ss_screen_get_nth_workspace   (SSScreen *screen, int n);
+SSWindow *      ss_screen_get_window_by_xid   (SSScreen *screen, gulong xid);
+SSWindow *      ss_screen_find_best_match     (SSScreen *screen, const char *query);
 
 void   ss_screen_activate_next_window                     (SSScreen *screen, gboolean backwards, guint32 time);
-void   ss_screen_activate_next_window_in_stacking_order   (SSScreen *screen, gboolean backwards, guint32 time);
+void   ss_screen_activate_next_window_in_focus_history    (SSScreen *screen, gboolean backwards, guint32 time);
 void   ss_screen_change_active_workspace                  (SSScreen *screen, int n, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time);
 void   ss_screen_change_active_workspace_by_delta         (SSScreen *screen, int delta, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time);
 void   ss_screen_change_active_workspace_to               (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport, gboolean also_bring_active_window, gboolean all_not_just_current_window, guint32 time);
+void   ss_screen_end_window_cycle                         (SSScreen *screen);
+void   ss_screen_prepare_for_show                         (SSScreen *screen);
+void   ss_screen_prepare_for_hide                         (SSScreen *screen);
 void   ss_screen_update_search                            (SSScreen *screen, const char *query);
-void   ss_screen_update_wnck_windows_in_stacking_order    (SSScreen *screen);
+void   ss_screen_update_stacking_order                    (SSScreen *screen);
 
 SSWorkspace *   ss_screen_get_workspace_for_wnck_window   (SSScreen *screen, WnckWindow *wnck_window);
+GPtrArray *     ss_screen_get_stacking_order_for_workspace   (SSScreen *screen, SSWorkspace *workspace);
 
 SSWorkspace *   ss_screen_find_workspace_near_point   (SSScreen *screen, int x, int y);
 #endif
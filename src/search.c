@@ -0,0 +1,400 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "search.h"
+
+#include <string.h>
+
+#include "screen.h"
+#include "window.h"
+#include "workspace.h"
+
+//------------------------------------------------------------------------------
+
+// Scoring weights for --fuzzy-search.
+#define SCORE_PER_CHARACTER     1
+#define SCORE_WORD_BOUNDARY     8
+#define SCORE_CONTIGUOUS        5
+#define SCORE_MAX_RECENCY      16
+
+//------------------------------------------------------------------------------
+
+gboolean use_fuzzy_search = FALSE;
+
+//------------------------------------------------------------------------------
+
+char *
+ss_search_fold_title (const char *title)
+{
+  if (title == NULL) {
+    return NULL;
+  }
+  return g_ascii_strdown (title, strlen (title));
+}
+
+//------------------------------------------------------------------------------
+
+// Returns a 64-bit set of the characters in a (folded) string: one bit each
+// for a-z and 0-9, and the other characters folded into the remaining bits.
+// A title can only match a term if the term's set is a subset of the title's
+// set, which lets us reject most windows without looking at their titles.
+guint64
+ss_search_charset (const char *folded)
+{
+  guint64 charset;
+  unsigned char c;
+
+  charset = 0;
+  if (folded == NULL) {
+    return charset;
+  }
+  for (; *folded; folded++) {
+    c = (unsigned char) *folded;
+    if (c >= 'a' && c <= 'z') {
+      charset |= ((guint64) 1) << (c - 'a');
+    } else if (c >= '0' && c <= '9') {
+      charset |= ((guint64) 1) << (26 + c - '0');
+    } else if (c != ' ') {
+      charset |= ((guint64) 1) << (36 + (c % 28));
+    }
+  }
+  return charset;
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+is_word_boundary (const char *title, int i)
+{
+  return (i == 0) || !g_ascii_isalnum (title[i - 1]);
+}
+
+//------------------------------------------------------------------------------
+
+// Scores the term as a subsequence of title, greedily matching from start.
+// Returns -1 if the term is not a subsequence.
+static int
+score_subsequence (const char *title, const char *term, int start)
+{
+  int score;
+  int previous;
+  int i;
+
+  score = 0;
+  previous = -2;
+  for (i = start; *term != '\0'; i++) {
+    if (title[i] == '\0') {
+      return -1;
+    }
+    if (title[i] != *term) {
+      continue;
+    }
+    score += SCORE_PER_CHARACTER;
+    if (is_word_boundary (title, i)) {
+      score += SCORE_WORD_BOUNDARY;
+    }
+    if (i == previous + 1) {
+      score += SCORE_CONTIGUOUS;
+    }
+    previous = i;
+    term++;
+  }
+  return score;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the score for window matching all of the terms, or -1 if it does
+// not match.  Without --fuzzy-search, every term must be a substring, and all
+// matches score zero.
+static int
+score_terms (SSWindow *window, gchar **terms, guint64 terms_charset)
+{
+  const char *title;
+  const char *found;
+  gchar *term;
+  int t;
+  int score;
+  int term_score;
+  int s;
+
+  title = window->folded_title;
+  if (title == NULL) {
+    return -1;
+  }
+  if ((terms_charset & ~window->folded_title_charset) != 0) {
+    return -1;
+  }
+
+  score = 0;
+  for (t = 0; terms[t] != NULL; t++) {
+    term = terms[t];
+    if (term[0] == '\0') {
+      continue;
+    }
+    found = strstr (title, term);
+    if (!use_fuzzy_search) {
+      if (found == NULL) {
+        return -1;
+      }
+      continue;
+    }
+
+    // Try both the first (greedy) subsequence match and the first substring
+    // match, since the latter is often the better scoring of the two.
+    term_score = score_subsequence (title, term, 0);
+    if (term_score < 0) {
+      return -1;
+    }
+    if (found != NULL) {
+      s = score_subsequence (title, term, found - title);
+      term_score = MAX (term_score, s);
+    }
+    score += term_score;
+  }
+
+  if (use_fuzzy_search) {
+    score += MAX (0, SCORE_MAX_RECENCY - window->stacking_rank);
+  }
+  return score;
+}
+
+//------------------------------------------------------------------------------
+
+static gint
+compare_by_score (gconstpointer a, gconstpointer b)
+{
+  SSWindow *wa;
+  SSWindow *wb;
+  wa = *((SSWindow **) a);
+  wb = *((SSWindow **) b);
+  if (wa->search_score != wb->search_score) {
+    return wb->search_score - wa->search_score;
+  }
+  return wa->stacking_rank - wb->stacking_rank;
+}
+
+//------------------------------------------------------------------------------
+
+static SSSearchLevel *
+search_level_new (const char *query)
+{
+  SSSearchLevel *level;
+  char *normalized_query;
+
+  normalized_query = g_ascii_strdown (query, strlen (query));
+  level = g_new (SSSearchLevel, 1);
+  level->query = g_strdup (query);
+  level->terms = g_strsplit (normalized_query, " ", 0);
+  level->terms_charset = ss_search_charset (normalized_query);
+  level->matches = g_ptr_array_new ();
+  g_free (normalized_query);
+  return level;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+search_level_free (SSSearchLevel *level)
+{
+  g_free (level->query);
+  g_strfreev (level->terms);
+  g_ptr_array_free (level->matches, TRUE);
+  g_free (level);
+}
+
+//------------------------------------------------------------------------------
+
+static SSSearchLevel *
+search_top_level (SSSearch *search)
+{
+  if (search->levels->len == 0) {
+    return NULL;
+  }
+  return (SSSearchLevel *) g_ptr_array_index (search->levels, search->levels->len - 1);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+search_pop_level (SSSearch *search)
+{
+  search_level_free ((SSSearchLevel *) g_ptr_array_remove_index (
+    search->levels, search->levels->len - 1));
+}
+
+//------------------------------------------------------------------------------
+
+static void
+search_level_add_if_matched (SSSearchLevel *level, SSWindow *window)
+{
+  gboolean matched;
+
+  window->search_score = score_terms (window, level->terms, level->terms_charset);
+  matched = (window->search_score >= 0);
+  if (matched != window->sensitive) {
+    ss_window_set_sensitive (window, matched);
+  }
+  if (matched) {
+    g_ptr_array_add (level->matches, window);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Filters candidates (or, if candidates is NULL, every window) into the
+// level's matches, updating each window's sensitivity only if it changed.
+static void
+search_level_fill (SSSearchLevel *level, SSScreen *screen, GPtrArray *candidates)
+{
+  SSWorkspace *workspace;
+  GList *i;
+  guint k;
+
+  if (candidates != NULL) {
+    for (k = 0; k < candidates->len; k++) {
+      search_level_add_if_matched (level, (SSWindow *) g_ptr_array_index (candidates, k));
+    }
+  } else {
+    for (i = screen->workspaces; i; i = i->next) {
+      workspace = (SSWorkspace *) i->data;
+      for (k = 0; k < workspace->windows->len; k++) {
+        search_level_add_if_matched (level, (SSWindow *) g_ptr_array_index (workspace->windows, k));
+      }
+    }
+  }
+
+  if (use_fuzzy_search) {
+    g_ptr_array_sort (level->matches, compare_by_score);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_search_invalidate (SSSearch *search)
+{
+  while (search->levels->len > 0) {
+    search_pop_level (search);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+int
+ss_search_update (SSSearch *search, const char *query)
+{
+  SSSearchLevel *top;
+  SSSearchLevel *level;
+  SSWindow *window;
+  guint k;
+
+  search->cursor = -1;
+
+  // Pop back to the longest cached query that is a prefix of this one.  The
+  // windows that are currently sensitive are always a subset of that level's
+  // matches, since they came from a level above it on the stack.
+  for (top = search_top_level (search); top != NULL; top = search_top_level (search)) {
+    if (strncmp (top->query, query, strlen (top->query)) == 0) {
+      break;
+    }
+    search_pop_level (search);
+  }
+
+  if (top != NULL && strcmp (top->query, query) == 0) {
+    for (k = 0; k < top->matches->len; k++) {
+      window = (SSWindow *) g_ptr_array_index (top->matches, k);
+      if (!window->sensitive) {
+        ss_window_set_sensitive (window, TRUE);
+      }
+    }
+    return top->matches->len;
+  }
+
+  // Adding characters (or terms) to a query can only narrow its matches, so
+  // we need only re-filter the previous level's matches.
+  level = search_level_new (query);
+  search_level_fill (level, search->screen, top != NULL ? top->matches : NULL);
+  g_ptr_array_add (search->levels, level);
+  return level->matches->len;
+}
+
+//------------------------------------------------------------------------------
+
+SSWindow *
+ss_search_next_ranked_match (SSSearch *search, gboolean backwards)
+{
+  SSSearchLevel *top;
+  int n;
+
+  top = search_top_level (search);
+  if (!use_fuzzy_search || top == NULL || top->query[0] == '\0') {
+    return NULL;
+  }
+  n = top->matches->len;
+  if (n == 0) {
+    return NULL;
+  }
+
+  if (search->cursor == -1) {
+    search->cursor = backwards ? n - 1 : 0;
+  } else {
+    search->cursor = (search->cursor + (backwards ? n - 1 : 1)) % n;
+  }
+  return (SSWindow *) g_ptr_array_index (top->matches, search->cursor);
+}
+
+//------------------------------------------------------------------------------
+
+// The single best match for the current query, without cycling: the best
+// scoring one with --fuzzy-search, or otherwise the most recently focused.
+SSWindow *
+ss_search_best_match (SSSearch *search)
+{
+  SSSearchLevel *top;
+  SSWindow *window;
+  SSWindow *best;
+  guint k;
+
+  top = search_top_level (search);
+  if (top == NULL || top->matches->len == 0) {
+    return NULL;
+  }
+  if (use_fuzzy_search) {
+    return (SSWindow *) g_ptr_array_index (top->matches, 0);
+  }
+  best = NULL;
+  for (k = 0; k < top->matches->len; k++) {
+    window = (SSWindow *) g_ptr_array_index (top->matches, k);
+    if (best == NULL || window->focus_stamp > best->focus_stamp) {
+      best = window;
+    }
+  }
+  return best;
+}
+
+//------------------------------------------------------------------------------
+
+SSSearch *
+ss_search_new (SSScreen *screen)
+{
+  SSSearch *search;
+  search = g_new (SSSearch, 1);
+  search->screen = screen;
+  search->levels = g_ptr_array_new ();
+  search->cursor = -1;
+  return search;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_search_free (SSSearch *search)
+{
+  if (search == NULL) {
+    return;
+  }
+  ss_search_invalidate (search);
+  g_ptr_array_free (search->levels, TRUE);
+  g_free (search);
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_SEARCH_H
+#define SUPERSWITCHER_SEARCH_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+
+// The search remembers the matches for each prefix of the current query, so
+// that typing one more character only re-filters the previous matches, and
+// Backspace simply pops back to an earlier set of matches.
+typedef struct _SSSearchLevel SSSearchLevel;
+struct _SSSearchLevel {
+  char *        query;
+  gchar **      terms;
+  guint64       terms_charset;
+  GPtrArray *   matches;
+};
+
+struct _SSSearch {
+  SSScreen *   screen;
+
+  // A stack of SSSearchLevels, each one's query being a prefix of the next.
+  GPtrArray *   levels;
+
+  // With --fuzzy-search, the index (into the top level's matches, which are
+  // sorted best first) of the match that Return last activated, or -1.
+  int   cursor;
+};
+
+SSSearch *   ss_search_new    (SSScreen *screen);
+void         ss_search_free   (SSSearch *search);
+
+void   ss_search_invalidate   (SSSearch *search);
+int    ss_search_update       (SSSearch *search, const char *query);
+
+SSWindow *   ss_search_next_ranked_match   (SSSearch *search, gboolean backwards);
+SSWindow *   ss_search_best_match          (SSSearch *search);
+
+char *    ss_search_fold_title   (const char *title);
+guint64   ss_search_charset      (const char *folded);
+
+#endif
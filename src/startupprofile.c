@@ -0,0 +1,76 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "startupprofile.h"
+
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+
+gboolean print_startup_profile = FALSE;
+
+typedef struct _SSStartupPhase SSStartupPhase;
+struct _SSStartupPhase {
+  const char *   name;
+  double         seconds;
+};
+
+static GTimer *timer = NULL;
+static double last_mark = 0.0;
+static GArray *phases = NULL;
+
+//------------------------------------------------------------------------------
+
+void
+ss_startup_profile_begin (void)
+{
+  timer = g_timer_new ();
+  last_mark = 0.0;
+  phases = g_array_new (FALSE, FALSE, sizeof (SSStartupPhase));
+}
+
+//------------------------------------------------------------------------------
+
+// Records that the named phase has just finished, having started when the
+// previous one finished.  The name must be a string literal.
+void
+ss_startup_profile_mark (const char *phase)
+{
+  SSStartupPhase p;
+  double now;
+
+  if (timer == NULL) {
+    return;
+  }
+  now = g_timer_elapsed (timer, NULL);
+  p.name = phase;
+  p.seconds = now - last_mark;
+  g_array_append_val (phases, p);
+  last_mark = now;
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_startup_profile_finish (void)
+{
+  SSStartupPhase *p;
+  guint i;
+
+  if (timer == NULL) {
+    return;
+  }
+  if (print_startup_profile) {
+    for (i = 0; i < phases->len; i++) {
+      p = &g_array_index (phases, SSStartupPhase, i);
+      fprintf (stderr, "superswitcher: startup: %-24s %8.2f ms\n",
+          p->name, 1000.0 * p->seconds);
+    }
+    fprintf (stderr, "superswitcher: startup: %-24s %8.2f ms\n",
+        "total", 1000.0 * g_timer_elapsed (timer, NULL));
+  }
+  g_timer_destroy (timer);
+  timer = NULL;
+  g_array_free (phases, TRUE);
+  phases = NULL;
+}
@@ -0,0 +1,18 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_STARTUPPROFILE_H
+#define SUPERSWITCHER_STARTUPPROFILE_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+
+// Times each phase of startup, from main until the initial windows have all
+// been added (see ss_screen_new).  With --startup-profile, the phases are
+// printed to stderr when startup finishes.
+void   ss_startup_profile_begin    (void);
+void   ss_startup_profile_mark     (const char *phase);
+void   ss_startup_profile_finish   (void);
+
+#endif
@@ -0,0 +1,111 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "stats.h"
+
+#ifdef HAVE_DBUS_GLIB
+#include "dbus-object.h"
+#endif
+
+//------------------------------------------------------------------------------
+
+static GTimer *stopwatch = NULL;
+
+static SSHistogram histograms[SS_NUM_LATENCIES];
+
+static const char *latency_names[SS_NUM_LATENCIES] = {
+  "popup_show",
+  "search_update",
+  "window_activation",
+  "thumbnail_render"
+};
+
+//------------------------------------------------------------------------------
+
+// Microseconds since (just before) the first call.  It is never 0, so that
+// callers can use 0 to mean "not started".  Only differences between two
+// calls are meaningful.
+guint64
+ss_stats_now_us (void)
+{
+  if (stopwatch == NULL) {
+    stopwatch = g_timer_new ();
+  }
+  return 1 + (guint64) (g_timer_elapsed (stopwatch, NULL) * 1e6);
+}
+
+//------------------------------------------------------------------------------
+
+static int
+bucket_for_value (guint value)
+{
+  int e;
+  if (value < SS_HISTOGRAM_SUB_BUCKETS) {
+    return value;
+  }
+  // e is the index of value's highest set bit, which is at least 2.
+  for (e = 2; (value >> e) > 1; e++) {
+  }
+  return SS_HISTOGRAM_SUB_BUCKETS +
+         (e - 2) * SS_HISTOGRAM_SUB_BUCKETS +
+         ((value >> (e - 2)) & (SS_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+//------------------------------------------------------------------------------
+
+guint
+ss_histogram_bucket_lower_bound (int bucket)
+{
+  int e;
+  int sub;
+  if (bucket < SS_HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  e = (bucket - SS_HISTOGRAM_SUB_BUCKETS) / SS_HISTOGRAM_SUB_BUCKETS + 2;
+  sub = (bucket - SS_HISTOGRAM_SUB_BUCKETS) % SS_HISTOGRAM_SUB_BUCKETS;
+  return (guint) (SS_HISTOGRAM_SUB_BUCKETS + sub) << (e - 2);
+}
+
+//------------------------------------------------------------------------------
+
+void
+ss_stats_record_latency (SSLatency latency, guint64 start_us)
+{
+  SSHistogram *h;
+  guint64 elapsed;
+  guint value;
+
+  g_return_if_fail (latency < SS_NUM_LATENCIES);
+  elapsed = ss_stats_now_us () - start_us;
+  value = elapsed > G_MAXUINT ? G_MAXUINT : (guint) elapsed;
+
+  h = &histograms[latency];
+  h->counts[bucket_for_value (value)]++;
+  h->count++;
+  h->sum_us += value;
+  if (h->max_us < value) {
+    h->max_us = value;
+  }
+
+#ifdef HAVE_DBUS_GLIB
+  ss_dbus_object_note_stats_changed ();
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+const SSHistogram *
+ss_stats_get_histogram (SSLatency latency)
+{
+  g_return_val_if_fail (latency < SS_NUM_LATENCIES, NULL);
+  return &histograms[latency];
+}
+
+//------------------------------------------------------------------------------
+
+const char *
+ss_stats_get_latency_name (SSLatency latency)
+{
+  g_return_val_if_fail (latency < SS_NUM_LATENCIES, NULL);
+  return latency_names[latency];
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_STATS_H
+#define SUPERSWITCHER_STATS_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+
+// Latencies are kept in log-linear ("HDR-style") histograms of microseconds.
+// Values below 4us get a bucket each, and every power of two above that is
+// split into 4 equal buckets, so that a bucket's lower bound is within 25% of
+// any value in it, and any guint fits in SS_HISTOGRAM_NUM_BUCKETS buckets.
+#define SS_HISTOGRAM_SUB_BUCKETS   4
+#define SS_HISTOGRAM_NUM_BUCKETS   124
+
+typedef enum {
+  SS_LATENCY_POPUP_SHOW,
+  SS_LATENCY_SEARCH_UPDATE,
+  SS_LATENCY_WINDOW_ACTIVATION,
+  SS_LATENCY_THUMBNAIL_RENDER,
+  SS_NUM_LATENCIES
+} SSLatency;
+
+struct _SSHistogram {
+  guint     counts[SS_HISTOGRAM_NUM_BUCKETS];
+  guint     count;
+  guint64   sum_us;
+  guint     max_us;
+};
+
+guint64   ss_stats_now_us            (void);
+void      ss_stats_record_latency    (SSLatency latency, guint64 start_us);
+
+const SSHistogram *   ss_stats_get_histogram      (SSLatency latency);
+const char *          ss_stats_get_latency_name   (SSLatency latency);
+guint                 ss_histogram_bucket_lower_bound   (int bucket);
+
+#endif
@@ -10,10 +10,19 @@
 #include <X11/X.h>
 #include <X11/Xlib.h>
 
+#include "focushistory.h"
+#include "idlestats.h"
 #include "screen.h"
 #include "popup.h"
+#include "startupprofile.h"
+#include "stats.h"
+#include "trace.h"
+#include "window.h"
+#include "workspace.h"
+#include "xinerama.h"
 
 #ifdef HAVE_DBUS_GLIB
+#include <dbus/dbus-glib.h>
 #include "dbus-object.h"
 #endif
 
@@ -40,13 +49,15 @@ static GdkFilterReturn
 filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
 {
   XEvent *x_event;
+  guint64 trace_start_us;
+  trace_start_us = SS_TRACE_BEGIN ();
   x_event = (XEvent *) gdk_xevent;
 
   switch (x_event->type) {
   case KeyPress:
-    if (popup == NULL && popup_keycode_to_free == -1) {
+    if (!popup->is_shown && popup_keycode_to_free == -1) {
       popup_keycode_to_free = x_event->xkey.keycode;
-      popup = popup_create (screen);
+      popup_show (popup);
     } else {
       popup_on_key_press (popup,
                           GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
@@ -56,8 +67,7 @@ filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
   case KeyRelease:
     if (popup_keycode_to_free == x_event->xkey.keycode) {
       popup_keycode_to_free = -1;
-      popup_free (popup);
-      popup = NULL;
+      popup_hide (popup);
     }
     break;
   default:
@@ -65,6 +75,7 @@ filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
     break;
   }
 
+  SS_TRACE_END ("filter_func", trace_start_us);
   return GDK_FILTER_CONTINUE;
 }
 
@@ -90,10 +101,7 @@ grab (int keyval)
 gboolean
 superswitcher_hide_popup (void *object, GError **error)
 {
-  if (popup) {
-    popup_free (popup);
-    popup = NULL;
-  }
+  popup_hide (popup);
   return TRUE;
 }
 
@@ -102,9 +110,7 @@ superswitcher_hide_popup (void *object, GError **error)
 gboolean
 superswitcher_show_popup (void *object, GError **error)
 {
-  if (!popup) {
-    popup = popup_create (screen);
-  }
+  popup_show (popup);
   return TRUE;
 }
 
@@ -113,7 +119,7 @@ superswitcher_show_popup (void *object, GError **error)
 gboolean
 superswitcher_toggle_popup (void *object, GError **error)
 {
-  if (popup) {
+  if (popup->is_shown) {
     return superswitcher_hide_popup (object, error);
   } else {
     return superswitcher_show_popup (object, error);
@@ -122,16 +128,426 @@ superswitcher_toggle_popup (void *object, GError **error)
 
 //------------------------------------------------------------------------------
 
+#ifdef HAVE_DBUS_GLIB
+static void
+free_dict_value (gpointer data)
+{
+  GValue *value;
+  value = (GValue *) data;
+  g_value_unset (value);
+  g_free (value);
+}
+
+//------------------------------------------------------------------------------
+
+// A new a{sv} dictionary, for the dict_insert_* functions below.
+static GHashTable *
+dict_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal,
+                                g_free, free_dict_value);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+dict_insert_boolean (GHashTable *dict, const char *key, gboolean b)
+{
+  GValue *value;
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (value, b);
+  g_hash_table_insert (dict, g_strdup (key), value);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+dict_insert_int (GHashTable *dict, const char *key, int i)
+{
+  GValue *value;
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_INT);
+  g_value_set_int (value, i);
+  g_hash_table_insert (dict, g_strdup (key), value);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+dict_insert_string (GHashTable *dict, const char *key, const char *str)
+{
+  GValue *value;
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_STRING);
+  g_value_set_string (value, str);
+  g_hash_table_insert (dict, g_strdup (key), value);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+dict_insert_uint (GHashTable *dict, const char *key, guint u)
+{
+  GValue *value;
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_UINT);
+  g_value_set_uint (value, u);
+  g_hash_table_insert (dict, g_strdup (key), value);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+dict_insert_uint64 (GHashTable *dict, const char *key, guint64 u)
+{
+  GValue *value;
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_UINT64);
+  g_value_set_uint64 (value, u);
+  g_hash_table_insert (dict, g_strdup (key), value);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+dict_insert_double (GHashTable *dict, const char *key, double d)
+{
+  GValue *value;
+  value = g_new0 (GValue, 1);
+  g_value_init (value, G_TYPE_DOUBLE);
+  g_value_set_double (value, d);
+  g_hash_table_insert (dict, g_strdup (key), value);
+}
+
+//------------------------------------------------------------------------------
+
+// Takes ownership of the array.
+static void
+dict_insert_uint_array (GHashTable *dict, const char *key, GArray *array)
+{
+  GValue *value;
+  value = g_new0 (GValue, 1);
+  g_value_init (value, DBUS_TYPE_G_UINT_ARRAY);
+  g_value_take_boxed (value, array);
+  g_hash_table_insert (dict, g_strdup (key), value);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+insert_latency_stats (GHashTable *stats, SSLatency latency)
+{
+  const SSHistogram *h;
+  const char *name;
+  char *key;
+  GArray *counts;
+  int n;
+
+  h = ss_stats_get_histogram (latency);
+  name = ss_stats_get_latency_name (latency);
+
+  // Trailing empty buckets are left out, and the bucket bounds are sent
+  // (once, as histogram_bucket_lower_bounds_us) rather than implied.
+  for (n = SS_HISTOGRAM_NUM_BUCKETS; n > 0 && h->counts[n - 1] == 0; n--) {
+  }
+  counts = g_array_sized_new (FALSE, FALSE, sizeof (guint), n);
+  g_array_append_vals (counts, h->counts, n);
+
+  key = g_strconcat (name, "_histogram", NULL);
+  dict_insert_uint_array (stats, key, counts);
+  g_free (key);
+  key = g_strconcat (name, "_count", NULL);
+  dict_insert_uint (stats, key, h->count);
+  g_free (key);
+  key = g_strconcat (name, "_sum_us", NULL);
+  dict_insert_uint64 (stats, key, h->sum_us);
+  g_free (key);
+  key = g_strconcat (name, "_max_us", NULL);
+  dict_insert_uint (stats, key, h->max_us);
+  g_free (key);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+count_materialized_window (gpointer key, gpointer value, gpointer data)
+{
+  if (((SSWindow *) value)->widget != NULL) {
+    (*((guint *) data))++;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+gboolean
+superswitcher_get_stats (void *object, GHashTable **stats, GError **error)
+{
+  const SSWindowUpdateStats *wus;
+  const SSIdleStats *is;
+  GArray *bounds;
+  guint bound;
+  guint num_materialized_windows;
+  int i;
+#ifdef HAVE_XCOMPOSITE
+  const SSThumbnailerStats *ts;
+#endif
+
+  *stats = dict_new ();
+
+  for (i = 0; i < SS_NUM_LATENCIES; i++) {
+    insert_latency_stats (*stats, i);
+  }
+  bounds = g_array_sized_new (FALSE, FALSE, sizeof (guint),
+                              SS_HISTOGRAM_NUM_BUCKETS);
+  for (i = 0; i < SS_HISTOGRAM_NUM_BUCKETS; i++) {
+    bound = ss_histogram_bucket_lower_bound (i);
+    g_array_append_val (bounds, bound);
+  }
+  dict_insert_uint_array (*stats, "histogram_bucket_lower_bounds_us", bounds);
+
+  dict_insert_uint (*stats, "x_round_trips", screen->xinerama->num_round_trips);
+  dict_insert_uint (*stats, "x_round_trips_last_show",
+                    screen->xinerama->num_round_trips_last_show);
+
+  wus = ss_window_get_update_stats ();
+  dict_insert_uint (*stats, "wnck_signals_received", wus->num_signals);
+  dict_insert_uint (*stats, "wnck_updates_applied", wus->num_updates);
+  dict_insert_uint (*stats, "wnck_update_flushes", wus->num_flushes);
+
+  // What the last hidden period (before the popup was last shown) cost.
+  is = ss_idle_stats_get_last ();
+  dict_insert_double (*stats, "idle_seconds_hidden", is->seconds_hidden);
+  if (is->seconds_hidden > 0.0) {
+    dict_insert_double (*stats, "idle_wakeups_per_second",
+                        is->num_wakeups / is->seconds_hidden);
+    dict_insert_double (*stats, "idle_cpu_percent",
+                        100.0 * is->cpu_seconds / is->seconds_hidden);
+  }
+  dict_insert_uint (*stats, "idle_window_signals", is->num_window_signals);
+
+#ifdef HAVE_XCOMPOSITE
+  ts = ss_thumbnailer_get_stats ();
+  dict_insert_uint (*stats, "thumbnail_shows", ts->num_shows);
+  dict_insert_uint (*stats, "thumbnail_shows_with_cold_thumbnails", ts->num_shows_with_cold_thumbnails);
+  dict_insert_uint (*stats, "thumbnails_drawn_cold", ts->num_cold_thumbnails_drawn);
+  dict_insert_uint (*stats, "thumbnails_drawn_warm", ts->num_warm_thumbnails_drawn);
+  dict_insert_uint (*stats, "thumbnails_prerendered", ts->num_prerendered_thumbnails);
+  dict_insert_uint (*stats, "thumbnails_evicted", ts->num_evicted_thumbnails);
+#endif
+
+  num_materialized_windows = 0;
+  g_hash_table_foreach (screen->windows_by_wnck_window,
+                        count_materialized_window, &num_materialized_windows);
+  dict_insert_uint (*stats, "num_windows",
+                    g_hash_table_size (screen->windows_by_wnck_window));
+  dict_insert_uint (*stats, "num_materialized_windows", num_materialized_windows);
+  dict_insert_uint (*stats, "num_workspaces", screen->num_workspaces);
+  dict_insert_uint (*stats, "num_pending_startup_windows",
+                    g_queue_get_length (screen->pending_wnck_windows));
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+gboolean
+superswitcher_get_trace (void *object, char **trace, GError **error)
+{
+  if (!record_trace) {
+    g_set_error (error, DBUS_GERROR, DBUS_GERROR_FAILED,
+                 "Tracing is off (start superswitcher with --trace)");
+    return FALSE;
+  }
+  *trace = ss_trace_to_json ();
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// Every window, most recently used first, from superswitcher's model (and
+// libwnck's cache), so that a client needs no X round trips of its own, and
+// this needs none either.
+gboolean
+superswitcher_list_windows (void *object, GPtrArray **windows, GError **error)
+{
+  SSWindow *window;
+  GHashTable *dict;
+  GList *i;
+  int mru_rank;
+
+  // Bring any coalesced libwnck changes (e.g. of viewport) into the model.
+  ss_window_flush_updates ();
+
+  *windows = g_ptr_array_new ();
+  mru_rank = 0;
+  for (i = screen->focus_history->windows->head; i; i = i->next) {
+    window = (SSWindow *) i->data;
+    dict = dict_new ();
+    dict_insert_uint (dict, "xid", wnck_window_get_xid (window->wnck_window));
+    dict_insert_string (dict, "title", wnck_window_get_name (window->wnck_window));
+    dict_insert_int (dict, "workspace",
+                     g_list_index (screen->workspaces, window->workspace));
+    dict_insert_int (dict, "order", window->index_in_workspace);
+    dict_insert_int (dict, "mru_rank", mru_rank++);
+    dict_insert_boolean (dict, "active", window == screen->active_window);
+    dict_insert_boolean (dict, "minimized",
+                         wnck_window_is_minimized (window->wnck_window));
+#ifdef HAVE_WNCK_2_12
+    dict_insert_boolean (dict, "needs_attention",
+                         wnck_window_needs_attention (window->wnck_window));
+#endif
+    g_ptr_array_add (*windows, dict);
+  }
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+gboolean
+superswitcher_list_workspaces (void *object, GPtrArray **workspaces, GError **error)
+{
+  SSWorkspace *workspace;
+  GHashTable *dict;
+  GList *i;
+  int j;
+
+  *workspaces = g_ptr_array_new ();
+  for (j = 0, i = screen->workspaces; i; j++, i = i->next) {
+    workspace = (SSWorkspace *) i->data;
+    dict = dict_new ();
+    dict_insert_int (dict, "index", j);
+    dict_insert_string (dict, "title", workspace->title);
+    dict_insert_string (dict, "name",
+                        wnck_workspace_get_name (workspace->wnck_workspace));
+    dict_insert_int (dict, "viewport", workspace->viewport);
+    dict_insert_uint (dict, "num_windows", workspace->windows->len);
+    dict_insert_boolean (dict, "active", workspace == screen->active_workspace);
+    g_ptr_array_add (*workspaces, dict);
+  }
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// An X server timestamp for activating a window outside of any X event (as
+// the window manager may ignore an activation stamped with 0).  This costs
+// one round trip.
+static guint32
+get_x_server_time (void)
+{
+  return gdk_x11_get_server_time (popup->window->window);
+}
+
+//------------------------------------------------------------------------------
+
+static SSWindow *
+get_window_by_xid_or_set_error (guint xid, GError **error)
+{
+  SSWindow *window;
+  window = ss_screen_get_window_by_xid (screen, xid);
+  if (window == NULL) {
+    g_set_error (error, DBUS_GERROR, DBUS_GERROR_INVALID_ARGS,
+                 "No window with XID 0x%x", xid);
+  }
+  return window;
+}
+
+//------------------------------------------------------------------------------
+
+// The activation methods below work on the model directly, without showing
+// (or building, or drawing) the popup.  If the popup is shown, it is hidden,
+// just as if the window had been activated from the popup.
+gboolean
+superswitcher_activate_window (void *object, guint xid, GError **error)
+{
+  SSWindow *window;
+
+  // The window's workspace (e.g. its viewport) must be up to date before we
+  // switch to it.
+  ss_window_flush_updates ();
+  window = get_window_by_xid_or_set_error (xid, error);
+  if (window == NULL) {
+    return FALSE;
+  }
+  popup_hide (popup);
+  ss_window_activate_workspace_and_window (window, get_x_server_time (), FALSE);
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// Activates the window that best matches query (see ss_screen_find_best_match)
+// and returns its XID, or 0 if no window matches.
+gboolean
+superswitcher_activate_best_match (void *object, const char *query, guint *xid, GError **error)
+{
+  SSWindow *window;
+  popup_hide (popup);
+  window = ss_screen_find_best_match (screen, query);
+  if (window == NULL) {
+    *xid = 0;
+    return TRUE;
+  }
+  *xid = wnck_window_get_xid (window->wnck_window);
+  ss_window_activate_workspace_and_window (window, get_x_server_time (), FALSE);
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+gboolean
+superswitcher_move_window_to_workspace (void *object, guint xid, int n, GError **error)
+{
+  SSWindow *window;
+  SSWorkspace *workspace;
+
+  // As for superswitcher_activate_window, the window's current workspace is
+  // where it is moved from.
+  ss_window_flush_updates ();
+  window = get_window_by_xid_or_set_error (xid, error);
+  if (window == NULL) {
+    return FALSE;
+  }
+  workspace = ss_screen_get_nth_workspace (screen, n);
+  if (workspace == NULL) {
+    g_set_error (error, DBUS_GERROR, DBUS_GERROR_INVALID_ARGS,
+                 "No workspace with index %d", n);
+    return FALSE;
+  }
+  ss_window_move_to_workspace (window, workspace);
+  return TRUE;
+}
+#endif
+
+//------------------------------------------------------------------------------
+
 int
 main (int argc, char **argv)
 {
   static const GOptionEntry options[] = {
     { "version", 'v', 0, G_OPTION_ARG_NONE, &show_version_and_exit,
       "Show the version number and exit", NULL },
+    { "fuzzy-search", 'f', 0, G_OPTION_ARG_NONE, &use_fuzzy_search,
+      "Match window titles fuzzily, and activate the best match first", NULL },
+    { "idle-stats", 0, 0, G_OPTION_ARG_NONE, &print_idle_stats,
+      "Print wakeups and CPU use while hidden, each time the popup is shown", NULL },
+    { "startup-profile", 0, 0, G_OPTION_ARG_NONE, &print_startup_profile,
+      "Print how long each phase of startup took", NULL },
+    { "trace", 0, 0, G_OPTION_ARG_NONE, &record_trace,
+      "Record a trace of recent activity, for the GetTrace D-Bus method", NULL },
 #ifdef HAVE_XCOMPOSITE
     { "show-window-thumbnails", 't', 0, G_OPTION_ARG_NONE,
       &show_window_thumbnails,
       "EXPERIMENTAL - Show window thumbnails (instead of icons)", NULL },
+    { "thumbnail-budget", 0, 0, G_OPTION_ARG_INT,
+      &thumbnail_prerender_budget_ms,
+      "Milliseconds per idle slice spent pre-rendering thumbnails (default 4)", "MS" },
+    { "thumbnail-cache-size", 0, 0, G_OPTION_ARG_INT,
+      &thumbnail_cache_size,
+      "Maximum number of thumbnails kept pre-rendered (default 256)", "N" },
+    { "thumbnail-interval", 0, 0, G_OPTION_ARG_INT,
+      &thumbnail_rerender_interval_ms,
+      "Minimum milliseconds between background re-renders of a thumbnail (default 1000)", "MS" },
 #endif
     { NULL }
   };
@@ -140,7 +556,9 @@ main (int argc, char **argv)
   GOptionContext *context;
   GError *error;
 
+  ss_startup_profile_begin ();
   gtk_init (&argc, &argv);
+  ss_startup_profile_mark ("gtk_init");
 
   context = g_option_context_new ("");
   error = NULL;
@@ -162,6 +580,7 @@ main (int argc, char **argv)
 #ifdef HAVE_DBUS_GLIB
   // Note that this may exit(...) if another instance is already running.
   init_superswitcher_dbus ();
+  ss_startup_profile_mark ("dbus");
 #endif
 
 #ifdef HAVE_XCOMPOSITE
@@ -175,10 +594,13 @@ main (int argc, char **argv)
 
   gdk_window_add_filter (root, filter_func, NULL);
   grab (XK_Tab);
+  ss_startup_profile_mark ("grab");
 
   screen = ss_screen_new (wnck_screen_get_default (),
                           GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
                           x_root_window);
+  popup = popup_create (screen);
+  ss_startup_profile_mark ("popup");
 
   gtk_main ();
 
@@ -6,6 +6,8 @@
 #include "thumbnailer.h"
 
 #include "screen.h"
+#include "stats.h"
+#include "trace.h"
 #include "window.h"
 #include "workspace.h"
 #include "xinerama.h"
@@ -17,12 +19,107 @@
 
 //------------------------------------------------------------------------------
 
-#define THUMBNAIL_SIZE 48
+// The atlas is a grid of THUMBNAIL_SIZE square slots, ATLAS_COLUMNS wide,
+// which grows (by doubling its number of rows) when it runs out of slots.
+#define ATLAS_COLUMNS 16
+#define ATLAS_INITIAL_ROWS 4
 
 //------------------------------------------------------------------------------
 
 gboolean show_window_thumbnails = FALSE;
 
+// While the popup is hidden, damaged (and new) thumbnails are re-rendered
+// in the background, at idle priority, spending at most
+// thumbnail_prerender_budget_ms per main loop iteration, and keeping at
+// most thumbnail_cache_size thumbnails warm (evicting the least recently
+// damaged or shown thumbnail to make room for a new one).  A window that keeps changing
+// (e.g. a video, or a busy terminal) is re-rendered at most once every
+// thumbnail_rerender_interval_ms, rather than whenever the queue drains.
+int thumbnail_prerender_budget_ms = 4;
+int thumbnail_cache_size = 256;
+int thumbnail_rerender_interval_ms = 1000;
+
+static GQueue *prerender_queue = NULL;
+static guint prerender_idle_id = 0;
+static GQueue *deferred_queue = NULL;
+static guint deferred_timeout_id = 0;
+
+// The thumbnailers that hold an atlas slot, least recently damaged or shown
+// first.  Each thumbnailer holds its own link (lru_link), so that using one,
+// or evicting the least recently used one, is O(1).
+static GQueue *lru_thumbnailers = NULL;
+static GTimer *prerender_timer = NULL;
+static gboolean popup_is_shown = FALSE;
+static gboolean current_show_has_cold_thumbnails = FALSE;
+
+static SSThumbnailerStats stats = { 0, 0, 0, 0, 0, 0 };
+
+// The XDamage event base, and the thumbnailers keyed by their window's XID,
+// so that DamageNotify events can be routed to the right thumbnailer.
+static int damage_event_base = 0;
+static GHashTable *thumbnailers_by_xid = NULL;
+
+// Every thumbnail is drawn into one shared, server-side pixmap, rather than
+// each window having its own pixmap and Picture. Freed slots are recycled
+// before the atlas grows.
+typedef struct _SSThumbnailAtlas SSThumbnailAtlas;
+struct _SSThumbnailAtlas {
+  GdkPixmap *   pixmap;
+  Picture       picture;
+  int           num_rows;
+  int           num_slots_ever_used;
+  int           num_slots_in_use;
+  GArray *      free_slots;
+};
+
+static SSThumbnailAtlas atlas = { NULL, None, 0, 0, 0, NULL };
+
+//------------------------------------------------------------------------------
+
+static void enqueue_for_prerendering (SSThumbnailer *thumbnailer);
+static void schedule_prerendering (void);
+
+//------------------------------------------------------------------------------
+
+// Marks the thumbnail as the most recently used.
+static void
+touch_thumbnailer (SSThumbnailer *thumbnailer)
+{
+  if ((thumbnailer->lru_link == NULL) || (lru_thumbnailers->tail == thumbnailer->lru_link)) {
+    return;
+  }
+  g_queue_unlink (lru_thumbnailers, thumbnailer->lru_link);
+  g_queue_push_tail_link (lru_thumbnailers, thumbnailer->lru_link);
+}
+
+//------------------------------------------------------------------------------
+
+static GdkFilterReturn
+damage_filter_func (GdkXEvent *gdk_xevent, GdkEvent *event, gpointer data)
+{
+  XEvent *x_event;
+  XDamageNotifyEvent *damage_event;
+  SSThumbnailer *thumbnailer;
+
+  x_event = (XEvent *) gdk_xevent;
+  if (x_event->type != damage_event_base + XDamageNotify) {
+    return GDK_FILTER_CONTINUE;
+  }
+
+  damage_event = (XDamageNotifyEvent *) x_event;
+  thumbnailer = (SSThumbnailer *) g_hash_table_lookup (thumbnailers_by_xid,
+      GUINT_TO_POINTER (damage_event->drawable));
+  if (thumbnailer != NULL && !thumbnailer->is_dirty) {
+    thumbnailer->is_dirty = TRUE;
+    touch_thumbnailer (thumbnailer);
+    if (thumbnailer->drawing_area != NULL) {
+      gtk_widget_queue_draw (thumbnailer->drawing_area);
+    }
+    enqueue_for_prerendering (thumbnailer);
+  }
+  return GDK_FILTER_REMOVE;
+}
+
 //------------------------------------------------------------------------------
 
 gboolean
@@ -57,6 +154,16 @@ init_composite (void)
     return FALSE;
   }
 
+  if (!XDamageQueryExtension (display, &damage_event_base, &error_base)) {
+    return FALSE;
+  }
+  thumbnailers_by_xid = g_hash_table_new (g_direct_hash, g_direct_equal);
+  prerender_queue = g_queue_new ();
+  deferred_queue = g_queue_new ();
+  lru_thumbnailers = g_queue_new ();
+  prerender_timer = g_timer_new ();
+  gdk_window_add_filter (NULL, damage_filter_func, NULL);
+
   XCompositeRedirectSubwindows (display,
       GDK_WINDOW_XWINDOW (gdk_get_default_root_window ()),
       CompositeRedirectAutomatic);
@@ -77,26 +184,113 @@ uninit_composite (void)
 
 //------------------------------------------------------------------------------
 
-// This code can only run after thumbnailer's drawing_area has been realized,
-// and after the main loop has run so that wnck_window is initialized.
+static void
+atlas_get_slot_position (int slot, int *x, int *y)
+{
+  *x = (slot % ATLAS_COLUMNS) * THUMBNAIL_SIZE;
+  *y = (slot / ATLAS_COLUMNS) * THUMBNAIL_SIZE;
+}
+
+//------------------------------------------------------------------------------
+
+// Replaces the atlas' pixmap with one that has num_rows rows, copying over
+// the thumbnails that were already rendered.
+static void
+atlas_resize (int num_rows)
+{
+  Display *display;
+  XRenderPictFormat *format;
+  GdkPixmap *pixmap;
+  GdkWindow *root;
+  GdkGC *gc;
+
+  display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  format = XRenderFindVisualFormat (display, DefaultVisual (
+      display, DefaultScreen (display)));
+  root = gdk_get_default_root_window ();
+
+  pixmap = gdk_pixmap_new (root,
+      ATLAS_COLUMNS * THUMBNAIL_SIZE, num_rows * THUMBNAIL_SIZE, -1);
+  if (atlas.pixmap != NULL) {
+    gc = gdk_gc_new (pixmap);
+    gdk_draw_drawable (pixmap, gc, atlas.pixmap, 0, 0, 0, 0,
+        ATLAS_COLUMNS * THUMBNAIL_SIZE, atlas.num_rows * THUMBNAIL_SIZE);
+    g_object_unref (gc);
+    XRenderFreePicture (display, atlas.picture);
+    g_object_unref (atlas.pixmap);
+  }
+
+  atlas.pixmap = pixmap;
+  atlas.picture = XRenderCreatePicture (display,
+      GDK_DRAWABLE_XID (pixmap), format, 0, NULL);
+  atlas.num_rows = num_rows;
+}
+
+//------------------------------------------------------------------------------
+
+static int
+atlas_allocate_slot (void)
+{
+  int slot;
+
+  if (atlas.free_slots == NULL) {
+    atlas.free_slots = g_array_new (FALSE, FALSE, sizeof (int));
+  }
+
+  if (atlas.free_slots->len > 0) {
+    slot = g_array_index (atlas.free_slots, int, atlas.free_slots->len - 1);
+    g_array_set_size (atlas.free_slots, atlas.free_slots->len - 1);
+  } else {
+    slot = atlas.num_slots_ever_used++;
+    if (atlas.pixmap == NULL) {
+      atlas_resize (ATLAS_INITIAL_ROWS);
+    } else if (slot >= atlas.num_rows * ATLAS_COLUMNS) {
+      atlas_resize (atlas.num_rows * 2);
+    }
+  }
+
+  atlas.num_slots_in_use++;
+  return slot;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+atlas_free_slot (int slot)
+{
+  atlas.num_slots_in_use--;
+  if (atlas.num_slots_in_use > 0) {
+    g_array_append_val (atlas.free_slots, slot);
+    return;
+  }
+
+  // The last thumbnail has gone, so give the atlas back to the X server.
+  XRenderFreePicture (GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
+      atlas.picture);
+  g_object_unref (atlas.pixmap);
+  atlas.pixmap = NULL;
+  atlas.picture = None;
+  atlas.num_rows = 0;
+  atlas.num_slots_ever_used = 0;
+  g_array_set_size (atlas.free_slots, 0);
+}
+
+//------------------------------------------------------------------------------
+
+// This code can only run after the main loop has run so that wnck_window is
+// initialized.
 static void
 initialize_thumbnailer_pictures (SSThumbnailer *thumbnailer)
 {
   Display *display;
-  GdkScreen *screen;
   XRenderPictFormat *format;
   XRenderPictureAttributes pa;
 
   display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
-  screen = gtk_widget_get_screen (thumbnailer->drawing_area);
   format = XRenderFindVisualFormat (display, DefaultVisual (
-      display, gdk_screen_get_number (screen)));
+      display, DefaultScreen (display)));
 
-  thumbnailer->thumbnail_pixmap = gdk_pixmap_new (
-      thumbnailer->drawing_area->window, THUMBNAIL_SIZE, THUMBNAIL_SIZE, -1);
-
-  thumbnailer->thumbnail_picture = XRenderCreatePicture (display,
-      GDK_DRAWABLE_XID (thumbnailer->thumbnail_pixmap), format, 0, NULL);
+  thumbnailer->atlas_slot = atlas_allocate_slot ();
 
   pa.subwindow_mode = IncludeInferiors;
   thumbnailer->window_picture = XRenderCreatePicture (display,
@@ -104,46 +298,125 @@ initialize_thumbnailer_pictures (SSThumbnailer *thumbnailer)
       format, CPSubwindowMode, &pa);
   XRenderSetPictureFilter (display, thumbnailer->window_picture,
       "good", NULL, 0);
+
+  thumbnailer->damage = XDamageCreate (display,
+      wnck_window_get_xid (thumbnailer->wnck_window), XDamageReportNonEmpty);
+  thumbnailer->is_dirty = TRUE;
+  g_queue_push_tail (lru_thumbnailers, thumbnailer);
+  thumbnailer->lru_link = lru_thumbnailers->tail;
+}
+
+//------------------------------------------------------------------------------
+
+// The inverse of initialize_thumbnailer_pictures, which gives the atlas slot
+// back and stops listening for damage.
+static void
+release_thumbnailer_pictures (SSThumbnailer *thumbnailer)
+{
+  Display *display;
+  display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+
+  if (thumbnailer->damage != None) {
+    XDamageDestroy (display, thumbnailer->damage);
+    thumbnailer->damage = None;
+  }
+  if (thumbnailer->atlas_slot >= 0) {
+    atlas_free_slot (thumbnailer->atlas_slot);
+    thumbnailer->atlas_slot = -1;
+  }
+  if (thumbnailer->lru_link != NULL) {
+    g_queue_delete_link (lru_thumbnailers, thumbnailer->lru_link);
+    thumbnailer->lru_link = NULL;
+  }
+  if (thumbnailer->window_picture != None) {
+    XRenderFreePicture (display, thumbnailer->window_picture);
+    thumbnailer->window_picture = None;
+  }
+  thumbnailer->is_dirty = TRUE;
+  thumbnailer->rendered_width = -1;
+  thumbnailer->rendered_height = -1;
 }
 
 //------------------------------------------------------------------------------
 
+// Frees up a slot, when the cache is full, by dropping the thumbnail that
+// was least recently damaged or shown.  That thumbnail will be cold, the
+// next time it is drawn.  A thumbnail that is on screen is never evicted,
+// but those were shown recently, so are (almost always) near the back of
+// the queue.  Returns FALSE if there was nothing to evict.
 static gboolean
-on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
+evict_least_recently_used (void)
 {
-  GdkGC *gc;
+  SSThumbnailer *lru;
+  GList *i;
+
+  lru = NULL;
+  for (i = lru_thumbnailers->head; i; i = i->next) {
+    lru = (SSThumbnailer *) i->data;
+    if ((lru->drawing_area == NULL) || !GTK_WIDGET_MAPPED (lru->drawing_area)) {
+      break;
+    }
+  }
+  if (i == NULL) {
+    return FALSE;
+  }
+  if (lru->is_queued) {
+    g_queue_remove (prerender_queue, lru);
+    g_queue_remove (deferred_queue, lru);
+    lru->is_queued = FALSE;
+  }
+  release_thumbnailer_pictures (lru);
+  stats.num_evicted_thumbnails++;
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// Evicts thumbnails until a new one fits within thumbnail_cache_size.
+// Returns FALSE if it does not, because every thumbnail is on screen.
+static gboolean
+make_room_in_atlas (void)
+{
+  while (atlas.num_slots_in_use >= thumbnail_cache_size) {
+    if (!evict_least_recently_used ()) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+// Re-scales the window into its atlas slot.
+static void
+render_thumbnail (SSThumbnailer *thumbnailer, int ww, int wh)
+{
+  Display *display;
   XTransform transform;
   double scale;
-  int wx, wy, ww, wh;
   int frame_left, frame_right, frame_top, frame_bottom;
-  int thumbnail_width, thumbnail_height;
-  int offset_x, offset_y;
+  int slot_x, slot_y;
   SSWindow *window;
-  SSThumbnailer *thumbnailer;
-  thumbnailer = (SSThumbnailer *) data;
-  window = thumbnailer->window;
+  guint64 start_us;
 
-  if (thumbnailer->thumbnail_pixmap == NULL) {
-    initialize_thumbnailer_pictures (thumbnailer);
-  }
-  gc = gdk_gc_new (thumbnailer->thumbnail_pixmap);
+  start_us = ss_stats_now_us ();
+  display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  window = thumbnailer->window;
 
   ss_xinerama_get_frame_extents (
       // TODO - should we cut out the ->workspace in the line below?
       window->workspace->screen->xinerama, window,
       &frame_left, &frame_right, &frame_top, &frame_bottom);
 
-  wnck_window_get_geometry (window->wnck_window, &wx, &wy, &ww, &wh);
-
   scale = ww > wh ? ww : wh;
   scale /= (double) THUMBNAIL_SIZE;
-  thumbnail_width = thumbnail_height = THUMBNAIL_SIZE;
+  thumbnailer->thumbnail_width = thumbnailer->thumbnail_height = THUMBNAIL_SIZE;
   if (ww > wh) {
-    thumbnail_height = wh * THUMBNAIL_SIZE / ww;
+    thumbnailer->thumbnail_height = wh * THUMBNAIL_SIZE / ww;
   } else {
-    thumbnail_width = ww * THUMBNAIL_SIZE / wh;
+    thumbnailer->thumbnail_width = ww * THUMBNAIL_SIZE / wh;
   }
-  
+
   transform.matrix[0][0] = XDoubleToFixed (scale);
   transform.matrix[0][1] = XDoubleToFixed (0.0);
   transform.matrix[0][2] = XDoubleToFixed (-frame_left * (scale - 1.0));
@@ -153,57 +426,252 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
   transform.matrix[2][0] = XDoubleToFixed (0.0);
   transform.matrix[2][1] = XDoubleToFixed (0.0);
   transform.matrix[2][2] = XDoubleToFixed (1.0);
-  XRenderSetPictureTransform (
-      GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
-      thumbnailer->window_picture,
-      &transform);
+  XRenderSetPictureTransform (display, thumbnailer->window_picture, &transform);
+
+  atlas_get_slot_position (thumbnailer->atlas_slot, &slot_x, &slot_y);
+  XRenderComposite (display,
+      PictOpSrc, thumbnailer->window_picture, None, atlas.picture,
+      0, 0, 0, 0, slot_x, slot_y, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+
+  // Re-arm the damage report, now that we've caught up with the window.
+  XDamageSubtract (display, thumbnailer->damage, None, None);
+  thumbnailer->is_dirty = FALSE;
+  thumbnailer->last_render_us = ss_stats_now_us ();
+  thumbnailer->rendered_width = ww;
+  thumbnailer->rendered_height = wh;
+
+  // This is only the client side's share: the X server composites
+  // asynchronously, after this returns.
+  ss_stats_record_latency (SS_LATENCY_THUMBNAIL_RENDER, start_us);
+}
 
-  XRenderComposite (
-      GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
-      PictOpSrc, thumbnailer->window_picture, None, thumbnailer->thumbnail_picture,
-      0, 0, 0, 0, 0, 0, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+//------------------------------------------------------------------------------
+
+static gboolean
+on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
+{
+  int wx, wy, ww, wh;
+  int offset_x, offset_y;
+  int slot_x, slot_y;
+  SSThumbnailer *thumbnailer;
+  guint64 trace_start_us;
+  thumbnailer = (SSThumbnailer *) data;
+
+  trace_start_us = SS_TRACE_BEGIN ();
+  if (thumbnailer->atlas_slot < 0) {
+    // The thumbnail has to be drawn, so if every other thumbnail is on
+    // screen too, the cache goes over budget until some scroll out of view.
+    make_room_in_atlas ();
+    initialize_thumbnailer_pictures (thumbnailer);
+  }
+  touch_thumbnailer (thumbnailer);
+
+  wnck_window_get_geometry (thumbnailer->wnck_window, &wx, &wy, &ww, &wh);
+  if (thumbnailer->is_dirty ||
+      ww != thumbnailer->rendered_width ||
+      wh != thumbnailer->rendered_height) {
+    render_thumbnail (thumbnailer, ww, wh);
+    stats.num_cold_thumbnails_drawn++;
+    if (popup_is_shown && !current_show_has_cold_thumbnails) {
+      current_show_has_cold_thumbnails = TRUE;
+      stats.num_shows_with_cold_thumbnails++;
+    }
+  } else {
+    stats.num_warm_thumbnails_drawn++;
+  }
 
-  offset_x = widget->allocation.x + (THUMBNAIL_SIZE - thumbnail_width) / 2;
-  offset_y = widget->allocation.y + (THUMBNAIL_SIZE - thumbnail_height) / 2;
+  offset_x = widget->allocation.x + (THUMBNAIL_SIZE - thumbnailer->thumbnail_width) / 2;
+  offset_y = widget->allocation.y + (THUMBNAIL_SIZE - thumbnailer->thumbnail_height) / 2;
 
-  gdk_draw_drawable (thumbnailer->drawing_area->window, gc,
-      thumbnailer->thumbnail_pixmap, 0, 0,
-      offset_x, offset_y, thumbnail_width, thumbnail_height);
+  atlas_get_slot_position (thumbnailer->atlas_slot, &slot_x, &slot_y);
+  gdk_draw_drawable (thumbnailer->drawing_area->window,
+      widget->style->fg_gc[GTK_STATE_NORMAL],
+      atlas.pixmap, slot_x, slot_y,
+      offset_x, offset_y,
+      thumbnailer->thumbnail_width, thumbnailer->thumbnail_height);
 
   gdk_draw_rectangle (thumbnailer->drawing_area->window,
       thumbnailer->drawing_area->style->black_gc, FALSE,
-      offset_x, offset_y, thumbnail_width - 1, thumbnail_height - 1);
+      offset_x, offset_y,
+      thumbnailer->thumbnail_width - 1, thumbnailer->thumbnail_height - 1);
+
+  SS_TRACE_END ("thumbnailer on_expose_event", trace_start_us);
+  return FALSE;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+prerender_thumbnail (SSThumbnailer *thumbnailer)
+{
+  int wx, wy, ww, wh;
+
+  if (thumbnailer->window->workspace == NULL) {
+    return;
+  }
+  if (thumbnailer->atlas_slot < 0) {
+    if (!make_room_in_atlas ()) {
+      return;
+    }
+    initialize_thumbnailer_pictures (thumbnailer);
+  }
+
+  wnck_window_get_geometry (thumbnailer->wnck_window, &wx, &wy, &ww, &wh);
+  if (thumbnailer->is_dirty ||
+      ww != thumbnailer->rendered_width ||
+      wh != thumbnailer->rendered_height) {
+    render_thumbnail (thumbnailer, ww, wh);
+    stats.num_prerendered_thumbnails++;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+requeue_deferred_in_timeout (gpointer data)
+{
+  SSThumbnailer *thumbnailer;
 
-  g_object_unref (gc);
+  deferred_timeout_id = 0;
+  while (!g_queue_is_empty (deferred_queue)) {
+    thumbnailer = (SSThumbnailer *) g_queue_pop_head (deferred_queue);
+    g_queue_push_tail (prerender_queue, thumbnailer);
+  }
+  schedule_prerendering ();
   return FALSE;
 }
 
 //------------------------------------------------------------------------------
 
+// Holds back a thumbnailer that was rendered too recently, so that it goes
+// back on the pre-render queue when the next re-render interval starts.  It
+// stays is_queued throughout.
+static void
+defer_prerendering (SSThumbnailer *thumbnailer)
+{
+  g_queue_push_tail (deferred_queue, thumbnailer);
+  if (deferred_timeout_id == 0) {
+    deferred_timeout_id = g_timeout_add (thumbnail_rerender_interval_ms,
+        requeue_deferred_in_timeout, NULL);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+prerender_in_idle (gpointer data)
+{
+  SSThumbnailer *thumbnailer;
+  guint64 now_us;
+
+  g_timer_start (prerender_timer);
+  now_us = ss_stats_now_us ();
+  while (!g_queue_is_empty (prerender_queue)) {
+    if (popup_is_shown ||
+        g_timer_elapsed (prerender_timer, NULL) * 1000.0 >= thumbnail_prerender_budget_ms) {
+      break;
+    }
+    thumbnailer = (SSThumbnailer *) g_queue_pop_head (prerender_queue);
+    if (thumbnailer->last_render_us != 0 &&
+        now_us - thumbnailer->last_render_us < (guint64) thumbnail_rerender_interval_ms * 1000) {
+      defer_prerendering (thumbnailer);
+      continue;
+    }
+    thumbnailer->is_queued = FALSE;
+    prerender_thumbnail (thumbnailer);
+  }
+
+  if (popup_is_shown || g_queue_is_empty (prerender_queue)) {
+    prerender_idle_id = 0;
+    return FALSE;
+  }
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+schedule_prerendering (void)
+{
+  if (prerender_idle_id != 0 || popup_is_shown ||
+      g_queue_is_empty (prerender_queue)) {
+    return;
+  }
+  prerender_idle_id = g_idle_add_full (G_PRIORITY_LOW,
+      prerender_in_idle, NULL, NULL);
+}
+
+//------------------------------------------------------------------------------
+
+// The most recently changed windows go to the front of the queue, since they
+// are the most likely to be shown (and looked at) next.
+static void
+enqueue_for_prerendering (SSThumbnailer *thumbnailer)
+{
+  if (!thumbnailer->is_queued) {
+    g_queue_push_head (prerender_queue, thumbnailer);
+    thumbnailer->is_queued = TRUE;
+  }
+  schedule_prerendering ();
+}
+
+//------------------------------------------------------------------------------
+
 SSThumbnailer *
-ss_thumbnailer_new (SSWindow *window, WnckWindow *wnck_window, GtkWidget *drawing_area)
+ss_thumbnailer_new (SSWindow *window, WnckWindow *wnck_window)
 {
   SSThumbnailer *t;
 
-  gtk_widget_set_size_request (drawing_area, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
-  gtk_widget_set_app_paintable (drawing_area, TRUE);
-
   t = g_new (SSThumbnailer, 1);
   t->window = window;
   t->wnck_window = wnck_window;
-  t->drawing_area = drawing_area;
-  t->thumbnail_pixmap = NULL;
-  t->thumbnail_picture = None;
+  t->drawing_area = NULL;
+  t->signal_id_expose = 0;
+  t->atlas_slot = -1;
   t->window_picture = None;
-
-  g_signal_connect (G_OBJECT (drawing_area), "expose-event",
-                    G_CALLBACK (on_expose_event),
-                    t);
+  t->damage = None;
+  t->is_dirty = TRUE;
+  t->last_render_us = 0;
+  t->lru_link = NULL;
+  t->rendered_width = -1;
+  t->rendered_height = -1;
+  t->thumbnail_width = THUMBNAIL_SIZE;
+  t->thumbnail_height = THUMBNAIL_SIZE;
+  t->is_queued = FALSE;
+  g_hash_table_insert (thumbnailers_by_xid,
+      GUINT_TO_POINTER (wnck_window_get_xid (wnck_window)), t);
+  enqueue_for_prerendering (t);
   return t;
 }
 
 //------------------------------------------------------------------------------
 
+// Sets (or, with NULL, unsets) the widget that the thumbnail is drawn on, when
+// the window's widgets are built (or destroyed).  The atlas slot is kept
+// either way.
+void
+ss_thumbnailer_set_drawing_area (SSThumbnailer *thumbnailer, GtkWidget *drawing_area)
+{
+  if (thumbnailer->drawing_area != NULL) {
+    g_signal_handler_disconnect (G_OBJECT (thumbnailer->drawing_area),
+                                 thumbnailer->signal_id_expose);
+    thumbnailer->signal_id_expose = 0;
+  }
+  thumbnailer->drawing_area = drawing_area;
+  if (drawing_area == NULL) {
+    return;
+  }
+
+  gtk_widget_set_size_request (drawing_area, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+  gtk_widget_set_app_paintable (drawing_area, TRUE);
+  thumbnailer->signal_id_expose =
+    g_signal_connect (G_OBJECT (drawing_area), "expose-event",
+                      G_CALLBACK (on_expose_event),
+                      thumbnailer);
+}
+
+//------------------------------------------------------------------------------
+
 void
 ss_thumbnailer_free (SSThumbnailer *thumbnailer)
 {
@@ -211,24 +679,39 @@ ss_thumbnailer_free (SSThumbnailer *thumbnailer)
     return;
   }
 
-  if (thumbnailer->thumbnail_pixmap != NULL) {
-    g_object_unref (thumbnailer->thumbnail_pixmap);
-    thumbnailer->thumbnail_pixmap = NULL;
+  ss_thumbnailer_set_drawing_area (thumbnailer, NULL);
+  g_hash_table_remove (thumbnailers_by_xid,
+      GUINT_TO_POINTER (wnck_window_get_xid (thumbnailer->wnck_window)));
+  if (thumbnailer->is_queued) {
+    g_queue_remove (prerender_queue, thumbnailer);
+    g_queue_remove (deferred_queue, thumbnailer);
   }
-  if (thumbnailer->thumbnail_picture != None) {
-    XRenderFreePicture (
-        GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
-        thumbnailer->thumbnail_picture);
-    thumbnailer->thumbnail_picture = None;
-  }
-  if (thumbnailer->window_picture != None) {
-    XRenderFreePicture (
-        GDK_DISPLAY_XDISPLAY (gdk_display_get_default ()),
-        thumbnailer->window_picture);
-    thumbnailer->window_picture = None;
+  release_thumbnailer_pictures (thumbnailer);
+  g_free (thumbnailer);
+}
+
+//------------------------------------------------------------------------------
+
+// Pre-rendering pauses while the popup is shown, since then the thumbnails
+// are rendered (if they need to be) as they are exposed.
+void
+ss_thumbnailer_set_popup_is_shown (gboolean is_shown)
+{
+  popup_is_shown = is_shown;
+  if (is_shown) {
+    stats.num_shows++;
+    current_show_has_cold_thumbnails = FALSE;
+  } else {
+    schedule_prerendering ();
   }
+}
 
-  g_free (thumbnailer);
+//------------------------------------------------------------------------------
+
+const SSThumbnailerStats *
+ss_thumbnailer_get_stats (void)
+{
+  return &stats;
 }
 
 #endif  // #ifdef HAVE_XCOMPOSITE
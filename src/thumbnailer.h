@@ -10,21 +10,67 @@
 #include "forward_declarations.h"
 
 #ifdef HAVE_XCOMPOSITE
+#include <X11/extensions/Xdamage.h>
 #include <X11/extensions/Xrender.h>
 
+#define THUMBNAIL_SIZE 48
+
+// A thumbnailer belongs to the window's model, not to its widgets, so that
+// its thumbnail is pre-rendered before the window is first shown, and is
+// kept (warm) while the window's widgets are scrolled out of view.  The
+// drawing_area is NULL whenever the window has no widgets.
 struct _SSThumbnailer {
   SSWindow *     window;
   WnckWindow *   wnck_window;
   GtkWidget *    drawing_area;
+  gulong         signal_id_expose;
+
+  // The thumbnail lives in a slot of the shared thumbnail atlas (see
+  // thumbnailer.c), or atlas_slot is -1 if it has not been rendered yet.
+  int       atlas_slot;
+  Picture   window_picture;
+
+  // The atlas slot holds a cached, scaled-down copy of the window, which
+  // is only re-rendered when XDamage tells us that the window has changed
+  // (or when the window's size has changed).  While the popup is hidden,
+  // it is re-rendered at most once per thumbnail_rerender_interval_ms (see
+  // thumbnailer.c), measured from last_render_us.
+  Damage     damage;
+  gboolean   is_dirty;
+  guint64    last_render_us;
+
+  // This thumbnailer's place in the atlas' least recently used order (see
+  // thumbnailer.c), or NULL if atlas_slot is -1.
+  GList *    lru_link;
+  int        rendered_width;
+  int        rendered_height;
+  int        thumbnail_width;
+  int        thumbnail_height;
 
-  GdkPixmap *   thumbnail_pixmap;
-  Picture       thumbnail_picture;
-  Picture       window_picture;
+  // Whether this thumbnailer is waiting in the background pre-render queue.
+  gboolean   is_queued;
 };
 
-SSThumbnailer *   ss_thumbnailer_new    (SSWindow *window, WnckWindow *wnck_window, GtkWidget *drawing_area);
+// A thumbnail is "cold" if it had to be (re-)rendered when the popup drew
+// it, rather than having been pre-rendered while the popup was hidden.
+typedef struct _SSThumbnailerStats SSThumbnailerStats;
+struct _SSThumbnailerStats {
+  guint   num_shows;
+  guint   num_shows_with_cold_thumbnails;
+  guint   num_cold_thumbnails_drawn;
+  guint   num_warm_thumbnails_drawn;
+  guint   num_prerendered_thumbnails;
+  guint   num_evicted_thumbnails;
+};
+
+SSThumbnailer *   ss_thumbnailer_new    (SSWindow *window, WnckWindow *wnck_window);
 void              ss_thumbnailer_free   (SSThumbnailer *thumbnailer);
 
+void   ss_thumbnailer_set_drawing_area   (SSThumbnailer *thumbnailer, GtkWidget *drawing_area);
+
+void                         ss_thumbnailer_set_popup_is_shown   (gboolean is_shown);
+const SSThumbnailerStats *   ss_thumbnailer_get_stats            (void);
+
 gboolean    init_composite     (void);
 gboolean    uninit_composite   (void);
 #endif
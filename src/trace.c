@@ -0,0 +1,77 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#include "trace.h"
+
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+
+gboolean record_trace = FALSE;
+
+typedef struct _SSTraceSpan SSTraceSpan;
+struct _SSTraceSpan {
+  const char *   name;
+  guint64        start_us;
+  guint          duration_us;
+};
+
+// superswitcher only records spans from the main loop's thread, so the ring
+// buffer needs no locking.  It is allocated by the first span.
+static SSTraceSpan *spans = NULL;
+static guint64 num_spans = 0;
+
+//------------------------------------------------------------------------------
+
+void
+ss_trace_record (const char *name, guint64 start_us)
+{
+  SSTraceSpan *span;
+  guint64 duration;
+
+  if (spans == NULL) {
+    spans = g_new (SSTraceSpan, TRACE_BUFFER_SIZE);
+  }
+  duration = ss_stats_now_us () - start_us;
+
+  span = &spans[num_spans % TRACE_BUFFER_SIZE];
+  span->name = name;
+  span->start_us = start_us;
+  span->duration_us = duration > G_MAXUINT ? G_MAXUINT : (guint) duration;
+  num_spans++;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns a newly allocated string, in the Chrome trace-event format's JSON
+// object form, of the spans in the ring buffer, oldest first.
+char *
+ss_trace_to_json (void)
+{
+  GString *json;
+  SSTraceSpan *span;
+  guint64 first;
+  guint64 i;
+  int pid;
+
+  pid = getpid ();
+  first = num_spans > TRACE_BUFFER_SIZE ? num_spans - TRACE_BUFFER_SIZE : 0;
+
+  json = g_string_new ("{\"traceEvents\":[");
+  g_string_append_printf (json,
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+      "\"args\":{\"name\":\"superswitcher\"}}",
+      pid, pid);
+  for (i = first; i < num_spans; i++) {
+    span = &spans[i % TRACE_BUFFER_SIZE];
+    g_string_append_printf (json,
+        ",\n{\"name\":\"%s\",\"cat\":\"superswitcher\",\"ph\":\"X\","
+        "\"ts\":%" G_GUINT64_FORMAT ",\"dur\":%u,\"pid\":%d,\"tid\":%d}",
+        span->name, span->start_us, span->duration_us, pid, pid);
+  }
+  g_string_append_printf (json,
+      "],\n\"displayTimeUnit\":\"ms\","
+      "\"otherData\":{\"dropped_spans\":\"%" G_GUINT64_FORMAT "\"}}\n",
+      first);
+  return g_string_free (json, FALSE);
+}
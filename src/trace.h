@@ -0,0 +1,39 @@
+// Copyright (c) 2006 Nigel Tao.
+// Licenced under the GNU General Public Licence (GPL) version 2.
+
+#ifndef SUPERSWITCHER_TRACE_H
+#define SUPERSWITCHER_TRACE_H
+
+#include <glib.h>
+
+#include "forward_declarations.h"
+#include "stats.h"
+
+// With --trace, spans around the hot paths (X event filters, libwnck signal
+// handlers, expose handlers, activation, etc.) are kept in a ring buffer of
+// the most recent TRACE_BUFFER_SIZE spans, which the GetTrace D-Bus method
+// returns as Chrome trace-event JSON (for chrome://tracing or Perfetto).
+//
+// Without --trace, SS_TRACE_BEGIN is one test of a global, and SS_TRACE_END
+// is one test of its result:
+//
+//   guint64 trace_start_us;
+//   trace_start_us = SS_TRACE_BEGIN ();
+//   ...
+//   SS_TRACE_END ("name", trace_start_us);
+//
+// The name must be a string literal, and a valid JSON string as is.
+#define TRACE_BUFFER_SIZE 16384
+
+#define SS_TRACE_BEGIN()   (record_trace ? ss_stats_now_us () : 0)
+#define SS_TRACE_END(name, start_us) \
+  G_STMT_START { \
+    if ((start_us) != 0) { \
+      ss_trace_record ((name), (start_us)); \
+    } \
+  } G_STMT_END
+
+void    ss_trace_record    (const char *name, guint64 start_us);
+char *  ss_trace_to_json   (void);
+
+#endif
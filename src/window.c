@@ -5,6 +5,9 @@
 
 #include "draganddrop.h"
 #include "screen.h"
+#include "search.h"
+#include "stats.h"
+#include "trace.h"
 #include "workspace.h"
 #include "xinerama.h"
 
@@ -17,39 +20,44 @@
 void
 ss_window_update_label_max_width_chars (SSWindow *window)
 {
+  if (window->label == NULL) {
+    return;
+  }
   gtk_label_set_max_width_chars (GTK_LABEL (window->label),
     window->screen->label_max_width_chars);
 }
 
 //------------------------------------------------------------------------------
 
+// Bold for a window that needs attention, and italic for a minimized one.
+// gtk_label_set_attributes replaces the label's whole attribute list, so both
+// go in the one list.
 static void
-ss_window_set_bold (SSWindow *window, gboolean bold)
+ss_window_update_label_attributes (SSWindow *window)
 {
   PangoAttribute *pa;
   PangoAttrList *pal;
+  gboolean bold;
+  gboolean italic;
+
+  if (window->label == NULL) {
+    return;
+  }
+#ifdef HAVE_WNCK_2_12
+  bold = wnck_window_needs_attention (window->wnck_window);
+#else
+  bold = wnck_window_demands_attention (window->wnck_window);
+#endif
+  italic = wnck_window_is_minimized (window->wnck_window);
 
+  pal = pango_attr_list_new ();
   pa = pango_attr_weight_new (bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
   pa->start_index = 0;
   pa->end_index = G_MAXINT;
-  pal = pango_attr_list_new ();
   pango_attr_list_insert (pal, pa);
-  gtk_label_set_attributes (GTK_LABEL (window->label), pal);
-  pango_attr_list_unref (pal);
-}
-
-//------------------------------------------------------------------------------
-
-static void
-ss_window_set_italic (SSWindow *window, gboolean italic)
-{
-  PangoAttribute *pa;
-  PangoAttrList *pal;
-
   pa = pango_attr_style_new (italic ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL);
   pa->start_index = 0;
   pa->end_index = G_MAXINT;
-  pal = pango_attr_list_new ();
   pango_attr_list_insert (pal, pa);
   gtk_label_set_attributes (GTK_LABEL (window->label), pal);
   pango_attr_list_unref (pal);
@@ -60,6 +68,9 @@ ss_window_set_italic (SSWindow *window, gboolean italic)
 void
 ss_window_set_selected (SSWindow *window, gboolean selected)
 {
+  if (window->label == NULL) {
+    return;
+  }
   gtk_widget_set_state (window->label,
     selected ? GTK_STATE_SELECTED : GTK_STATE_NORMAL);
 }
@@ -69,9 +80,12 @@ ss_window_set_selected (SSWindow *window, gboolean selected)
 void
 ss_window_set_sensitive (SSWindow *window, gboolean sensitive)
 {
+  window->sensitive = sensitive;
+  if (window->widget == NULL) {
+    return;
+  }
   gtk_widget_set_sensitive (GTK_WIDGET (window->image), sensitive);
   gtk_widget_set_sensitive (GTK_WIDGET (window->label), sensitive);
-  window->sensitive = sensitive;
 }
 
 //------------------------------------------------------------------------------
@@ -80,9 +94,11 @@ void
 ss_window_activate_workspace_and_window (SSWindow *window, guint32 time,
                                          gboolean also_warp_pointer_if_necessary)
 {
+  guint64 trace_start_us;
   if (window == NULL) {
     return;
   }
+  trace_start_us = SS_TRACE_BEGIN ();
   if (window->workspace != NULL) {
     if (window_manager_uses_viewports) {
       wnck_screen_move_viewport (
@@ -92,6 +108,7 @@ ss_window_activate_workspace_and_window (SSWindow *window, guint32 time,
     }
   }
   ss_window_activate_window (window, time + 1, also_warp_pointer_if_necessary);
+  SS_TRACE_END ("ss_window_activate_workspace_and_window", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -101,10 +118,16 @@ ss_window_activate_window (SSWindow *window, guint32 time,
                            gboolean also_warp_pointer_if_necessary)
 {
   GdkRectangle r;
+  guint64 trace_start_us;
   if (window == NULL) {
     return;
   }
 
+  trace_start_us = SS_TRACE_BEGIN ();
+  if (window != window->screen->active_window) {
+    window->screen->activating_window = window;
+    window->screen->activation_start_us = ss_stats_now_us ();
+  }
   wnck_window_activate (window->wnck_window, time);
   if (also_warp_pointer_if_necessary &&
       window->screen->pointer_needs_recentering_on_focus_change) {
@@ -115,6 +138,7 @@ ss_window_activate_window (SSWindow *window, guint32 time,
                   0, 0, 0, 0, 
                   r.x + (r.width / 2), r.y + (r.height / 2));
   }
+  SS_TRACE_END ("ss_window_activate_window", trace_start_us);
 }
 
 //------------------------------------------------------------------------------
@@ -133,7 +157,10 @@ ss_window_update_for_new_workspace (SSWindow *window, SSWorkspace *new_workspace
     ss_workspace_add_window (new_workspace, window);
   }
   window->new_window_index = -1;
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (window->widget));
+  ss_search_invalidate (window->screen->search);
+  if (window->widget != NULL) {
+    gtk_widget_queue_draw (gtk_widget_get_toplevel (window->widget));
+  }
 }
 
 
@@ -214,9 +241,7 @@ on_button_release_event (GtkWidget *widget, GdkEventButton *event, gpointer data
         // to a new position of new_window_index == 3,
         // which needs to be adjusted by -1.
         if (dnd->new_window_index >
-          g_list_index (
-          dnd->drag_start_workspace->windows,
-          dnd->drag_start_window)) {
+          dnd->drag_start_window->index_in_workspace) {
 
           dnd->new_window_index -= 1;
         }
@@ -249,48 +274,178 @@ on_motion_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer data)
 
 //------------------------------------------------------------------------------
 
+// Roughly one frame at 30 frames per second.
+#define WINDOW_UPDATE_INTERVAL_MS 33
+
+static GPtrArray *dirty_windows = NULL;
+static guint flush_timeout_id = 0;
+static gboolean updates_are_suspended = FALSE;
+
+static SSWindowUpdateStats update_stats = { 0, 0, 0 };
+
+//------------------------------------------------------------------------------
+
 static void
-on_geometry_changed (WnckWindow *wnck_window, gpointer data)
+apply_updates (SSWindow *window)
+{
+  const char *name;
+  WnckWindow *wnck_window;
+  WnckWindowState changed_mask;
+  guint flags;
+
+  wnck_window = window->wnck_window;
+  flags = window->dirty_flags;
+  window->dirty_flags = 0;
+
+  if (flags & SS_WINDOW_DIRTY_GEOMETRY) {
+    ss_workspace_invalidate_mini_map (window->workspace);
+    if (window_manager_uses_viewports) {
+      ss_window_update_for_new_workspace (window,
+        ss_screen_get_workspace_for_wnck_window (window->screen, wnck_window));
+    }
+  }
+
+  if ((flags & SS_WINDOW_DIRTY_ICON) && (window->image != NULL)) {
+    gtk_image_set_from_pixbuf (GTK_IMAGE(window->image),
+      wnck_window_get_mini_icon (wnck_window));
+  }
+
+  if (flags & SS_WINDOW_DIRTY_STATE) {
+    changed_mask = window->dirty_state_mask;
+    window->dirty_state_mask = 0;
+#ifdef HAVE_WNCK_2_12
+    if (changed_mask & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION | WNCK_WINDOW_STATE_URGENT |
+                        WNCK_WINDOW_STATE_MINIMIZED)) {
+#else
+    if (changed_mask & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION | WNCK_WINDOW_STATE_MINIMIZED)) {
+#endif
+      ss_window_update_label_attributes (window);
+    }
+    if (changed_mask & WNCK_WINDOW_STATE_MINIMIZED) {
+      ss_workspace_invalidate_mini_map (window->workspace);
+    }
+  }
+
+  if (flags & SS_WINDOW_DIRTY_NAME) {
+    name = wnck_window_get_name (wnck_window);
+    g_free (window->folded_title);
+    window->folded_title = ss_search_fold_title (name);
+    window->folded_title_charset = ss_search_charset (window->folded_title);
+    ss_search_invalidate (window->screen->search);
+    if (window->widget != NULL) {
+      gtk_label_set_text (GTK_LABEL (window->label), name);
+#ifdef HAVE_GTK_2_11
+      gtk_widget_set_tooltip_text (window->widget, name);
+#else
+      if (window->workspace) {
+        gtk_tooltips_set_tip (GTK_TOOLTIPS (window->screen->tooltips), window->widget, name, "");
+      }
+#endif
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Applies every pending update now, e.g. just before the popup is shown.
+void
+ss_window_flush_updates (void)
 {
   SSWindow *window;
-  window = (SSWindow *) data;
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (window->widget));
-  if (window_manager_uses_viewports) {
-    ss_window_update_for_new_workspace (window,
-      ss_screen_get_workspace_for_wnck_window (window->screen, wnck_window));
+  guint i;
+  guint64 trace_start_us;
+
+  if (flush_timeout_id != 0) {
+    g_source_remove (flush_timeout_id);
+    flush_timeout_id = 0;
+  }
+  if ((dirty_windows == NULL) || (dirty_windows->len == 0)) {
+    return;
   }
+
+  trace_start_us = SS_TRACE_BEGIN ();
+  for (i = 0; i < dirty_windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (dirty_windows, i);
+    apply_updates (window);
+    update_stats.num_updates++;
+  }
+  g_ptr_array_set_size (dirty_windows, 0);
+  update_stats.num_flushes++;
+  SS_TRACE_END ("ss_window_flush_updates", trace_start_us);
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+flush_updates_in_timeout (gpointer data)
+{
+  flush_timeout_id = 0;
+  ss_window_flush_updates ();
+  return FALSE;
 }
 
 //------------------------------------------------------------------------------
 
 static void
-on_icon_changed (WnckWindow *wnck_window, gpointer data)
+mark_dirty (SSWindow *window, guint flags)
 {
-  SSWindow *window;
-  window = (SSWindow *) data;
-  gtk_image_set_from_pixbuf (GTK_IMAGE(window->image),
-    wnck_window_get_mini_icon (wnck_window));
+  update_stats.num_signals++;
+  if (window->dirty_flags == 0) {
+    if (dirty_windows == NULL) {
+      dirty_windows = g_ptr_array_new ();
+    }
+    g_ptr_array_add (dirty_windows, window);
+  }
+  window->dirty_flags |= flags;
+
+  if (!updates_are_suspended && (flush_timeout_id == 0)) {
+    flush_timeout_id = g_timeout_add (WINDOW_UPDATE_INTERVAL_MS,
+        flush_updates_in_timeout, NULL);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Resuming applies every update that was put off while suspended.
+void
+ss_window_set_updates_suspended (gboolean suspended)
+{
+  updates_are_suspended = suspended;
+  if (!suspended) {
+    ss_window_flush_updates ();
+  }
 }
 
+//------------------------------------------------------------------------------
+
+const SSWindowUpdateStats *
+ss_window_get_update_stats (void)
+{
+  return &update_stats;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+on_geometry_changed (WnckWindow *wnck_window, gpointer data)
+{
+  mark_dirty ((SSWindow *) data, SS_WINDOW_DIRTY_GEOMETRY);
+}
+
+//------------------------------------------------------------------------------
+
+static void
+on_icon_changed (WnckWindow *wnck_window, gpointer data)
+{
+  mark_dirty ((SSWindow *) data, SS_WINDOW_DIRTY_ICON);
+}
 
 //------------------------------------------------------------------------------
 
 static void
 on_name_changed (WnckWindow *wnck_window, gpointer data)
 {
-  SSWindow *window;
-  const char *name;
-  window = (SSWindow *) data;
-  name = wnck_window_get_name (wnck_window);
-  gtk_label_set_text (GTK_LABEL (window->label), name);
-#ifdef HAVE_GTK_2_11
-  gtk_widget_set_tooltip_text (window->widget, name);
-#else
-  if (window->workspace) {
-    gtk_tooltips_set_tip (GTK_TOOLTIPS (window->screen->tooltips), window->widget, name, "");
-  }
-#endif
-  gtk_widget_queue_draw (gtk_widget_get_toplevel (window->widget));
+  mark_dirty ((SSWindow *) data, SS_WINDOW_DIRTY_NAME);
 }
 
 //------------------------------------------------------------------------------
@@ -300,18 +455,8 @@ on_state_changed (WnckWindow *wnck_window, WnckWindowState changed_mask, WnckWin
 {
   SSWindow *window;
   window = (SSWindow *) data;
-#ifdef HAVE_WNCK_2_12
-  if (changed_mask & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION | WNCK_WINDOW_STATE_URGENT)) {
-    ss_window_set_bold (window, wnck_window_needs_attention (wnck_window));
-  }
-#else
-  if (changed_mask & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION)) {
-    ss_window_set_bold (window, wnck_window_demands_attention (wnck_window));
-  }
-#endif
-  if (changed_mask & WNCK_WINDOW_STATE_MINIMIZED) {
-    ss_window_set_italic (window, wnck_window_is_minimized (wnck_window));
-  }
+  window->dirty_state_mask |= changed_mask;
+  mark_dirty (window, SS_WINDOW_DIRTY_STATE);
 }
 
 //------------------------------------------------------------------------------
@@ -344,8 +489,10 @@ static gboolean
 on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
 {
   SSWindow *window;
+  guint64 trace_start_us;
   window = (SSWindow *) data;
 
+  trace_start_us = SS_TRACE_BEGIN ();
   if (window == window->screen->active_window) {
     gtk_paint_box (widget->style,
       widget->window,
@@ -359,6 +506,7 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
       widget->allocation.width  + 4,
       widget->allocation.height + 2);
   }
+  SS_TRACE_END ("window on_expose_event", trace_start_us);
   return FALSE;
 }
 
@@ -368,22 +516,80 @@ SSWindow *
 ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
 {
   SSWindow *w;
+  w = g_new (SSWindow, 1);
+
+  w->screen = workspace->screen;
+  w->workspace = workspace;
+  w->wnck_window = wnck_window;
+  w->widget = NULL;
+  w->image = NULL;
+  w->label = NULL;
+  w->folded_title = ss_search_fold_title (wnck_window_get_name (wnck_window));
+  w->folded_title_charset = ss_search_charset (w->folded_title);
+  w->search_score = 0;
+  w->stacking_rank = G_MAXINT / 2;
+  w->index_in_workspace = -1;
+  w->mru_link = NULL;
+  w->workspace_mru_link = NULL;
+  w->focus_stamp = 0;
+  w->cycle_serial = 0;
+  w->frame_extents_are_valid = FALSE;
+  w->frame_left = w->frame_right = w->frame_top = w->frame_bottom = 0;
+#ifdef HAVE_XCOMPOSITE
+  w->thumbnailer = show_window_thumbnails ? ss_thumbnailer_new (w, wnck_window) : NULL;
+#endif
+  w->sensitive = TRUE;
+  w->dirty_flags = 0;
+  w->dirty_state_mask = 0;
+  w->new_window_index = -1;
+  w->signal_id_geometry_changed =
+    g_signal_connect (G_OBJECT (wnck_window), "geometry-changed",
+    (GCallback) on_geometry_changed,
+    w);
+  w->signal_id_icon_changed = 0;
+  w->signal_id_name_changed =
+    g_signal_connect (G_OBJECT (wnck_window), "name-changed",
+    (GCallback) on_name_changed,
+    w);
+  w->signal_id_state_changed =
+    g_signal_connect (G_OBJECT (wnck_window), "state-changed",
+    (GCallback) on_state_changed,
+    w);
+  w->signal_id_workspace_changed =
+    g_signal_connect (G_OBJECT (wnck_window), "workspace-changed",
+    (GCallback) on_workspace_changed,
+    w);
+  return w;
+}
+
+//------------------------------------------------------------------------------
+
+// Builds the window's widgets, if they haven't been built already.  The
+// caller (see ss_workspace_update_visible_windows) packs them into the popup.
+// Nothing of the window is drawn until the popup is first shown, so there is
+// no point in building (and then keeping up to date) hundreds of widgets at
+// startup.
+void
+ss_window_materialize (SSWindow *w)
+{
   GtkWidget *eventbox;
   GtkWidget *hbox;
   GtkWidget *image;
   GtkWidget *label;
   GdkColor *color;
-#ifdef HAVE_XCOMPOSITE
-  SSThumbnailer *thumbnailer;
-#endif
-  w = g_new (SSWindow, 1);
+  WnckWindow *wnck_window;
+
+  if (w->widget != NULL) {
+    return;
+  }
+  wnck_window = w->wnck_window;
 
   eventbox = gtk_event_box_new ();
   gtk_event_box_set_visible_window (GTK_EVENT_BOX (eventbox), FALSE);
 #ifdef HAVE_GTK_2_11
   gtk_widget_set_tooltip_text (eventbox, wnck_window_get_name (wnck_window));
 #else
-  gtk_tooltips_set_tip (GTK_TOOLTIPS (workspace->screen->tooltips),
+  gtk_tooltips_set_tip (GTK_TOOLTIPS (w->screen->tooltips),
     eventbox, wnck_window_get_name (wnck_window), "");
 #endif
 
@@ -391,46 +597,33 @@ ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
   gtk_container_add (GTK_CONTAINER (eventbox), hbox);
 
 #ifdef HAVE_XCOMPOSITE
-  if (show_window_thumbnails) {
+  if (w->thumbnailer != NULL) {
     // Really, all I need is any GtkWidget (so that I can have an allocation
     // and set a preferred size) that doesn't have its own X window (so that
     // it doesn't try to paint itself).
     image = gtk_fixed_new ();
-    thumbnailer = ss_thumbnailer_new (w, wnck_window, image);
+    ss_thumbnailer_set_drawing_area (w->thumbnailer, image);
   } else {
 #endif
     image = gtk_image_new ();
     gtk_image_set_from_pixbuf (GTK_IMAGE(image), wnck_window_get_mini_icon (wnck_window));
 #ifdef HAVE_XCOMPOSITE
-    thumbnailer = NULL;
   }
 #endif
   gtk_box_pack_start (GTK_BOX (hbox), image, FALSE, FALSE, 0);
 
   label = gtk_label_new (wnck_window_get_name (wnck_window));
   gtk_box_pack_start (GTK_BOX (hbox), label, TRUE, TRUE, 0);
-  gtk_label_set_max_width_chars (GTK_LABEL (label), workspace->screen->label_max_width_chars);
+  gtk_label_set_max_width_chars (GTK_LABEL (label), w->screen->label_max_width_chars);
   gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_MIDDLE);
   gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
 
   color = & (gtk_widget_get_default_style ()->text[GTK_STATE_SELECTED]);
   gtk_widget_modify_fg (label, GTK_STATE_SELECTED, color);
 
-  w->screen = workspace->screen;
-  w->workspace = workspace;
-  w->wnck_window = wnck_window;
   w->widget = eventbox;
   w->image = image;
   w->label = label;
-#ifdef HAVE_XCOMPOSITE
-  w->thumbnailer = thumbnailer;
-#endif
-  w->sensitive = TRUE;
-  w->new_window_index = -1;
-  w->signal_id_geometry_changed =
-    g_signal_connect (G_OBJECT (wnck_window), "geometry-changed",
-    (GCallback) on_geometry_changed,
-    w);
   w->signal_id_icon_changed =
 #ifdef HAVE_XCOMPOSITE
     show_window_thumbnails ? 0L :
@@ -438,18 +631,6 @@ ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
     g_signal_connect (G_OBJECT (wnck_window), "icon-changed",
     (GCallback) on_icon_changed,
     w);
-  w->signal_id_name_changed =
-    g_signal_connect (G_OBJECT (wnck_window), "name-changed",
-    (GCallback) on_name_changed,
-    w);
-  w->signal_id_state_changed =
-    g_signal_connect (G_OBJECT (wnck_window), "state-changed",
-    (GCallback) on_state_changed,
-    w);
-  w->signal_id_workspace_changed =
-    g_signal_connect (G_OBJECT (wnck_window), "workspace-changed",
-    (GCallback) on_workspace_changed,
-    w);
   g_signal_connect (G_OBJECT (hbox), "expose-event",
     (GCallback) on_expose_event,
     w);
@@ -463,16 +644,50 @@ ss_window_new (SSWorkspace *workspace, WnckWindow *wnck_window)
     (GCallback) on_motion_notify_event,
     w);
   g_object_ref (w->widget);
-#ifdef HAVE_WNCK_2_12
-  if (wnck_window_needs_attention (wnck_window)) {
-    ss_window_set_bold (w, TRUE);
+  ss_window_update_label_attributes (w);
+  if (w == w->screen->active_window) {
+    ss_window_set_selected (w, TRUE);
   }
-#else
-  if (wnck_window_demands_attention (wnck_window)) {
-    ss_window_set_bold (w, TRUE);
+  if (!w->sensitive) {
+    ss_window_set_sensitive (w, FALSE);
+  }
+  gtk_widget_show_all (w->widget);
+}
+
+//------------------------------------------------------------------------------
+
+// The opposite of ss_window_materialize, for a window that has scrolled out
+// of view.  The caller has already unpacked the widget.
+void
+ss_window_dematerialize (SSWindow *window)
+{
+  SSDragAndDrop *dnd;
+
+  if (window->widget == NULL) {
+    return;
+  }
+  // A drag can outlive its source's widgets, if the source is scrolled out
+  // of view (e.g. after a focus change) mid-drag.
+  dnd = window->screen->drag_and_drop;
+  if ((dnd != NULL) && (dnd->drag_start_widget == window->widget)) {
+    dnd->drag_start_widget = NULL;
+  }
+  if (window->signal_id_icon_changed) {
+    g_signal_handler_disconnect (G_OBJECT (window->wnck_window),
+      window->signal_id_icon_changed);
+    window->signal_id_icon_changed = 0;
+  }
+#ifdef HAVE_XCOMPOSITE
+  // The thumbnailer (and its pre-rendered thumbnail) outlives the widgets.
+  if (window->thumbnailer != NULL) {
+    ss_thumbnailer_set_drawing_area (window->thumbnailer, NULL);
   }
 #endif
-  return w;
+  gtk_widget_destroy (window->widget);
+  g_object_unref (window->widget);
+  window->widget = NULL;
+  window->image = NULL;
+  window->label = NULL;
 }
 
 //------------------------------------------------------------------------------
@@ -483,6 +698,9 @@ ss_window_free (SSWindow *window)
   if (window == NULL) {
     return;
   }
+  if (window->dirty_flags != 0) {
+    g_ptr_array_remove_fast (dirty_windows, window);
+  }
   g_signal_handler_disconnect (G_OBJECT (window->wnck_window),
     window->signal_id_geometry_changed);
   if (window->signal_id_icon_changed) {
@@ -495,9 +713,14 @@ ss_window_free (SSWindow *window)
     window->signal_id_state_changed);
   g_signal_handler_disconnect (G_OBJECT (window->wnck_window),
     window->signal_id_workspace_changed);
-  g_object_unref (window->widget);
 #ifdef HAVE_XCOMPOSITE
-  ss_thumbnailer_free (window->thumbnailer);
+  if (window->thumbnailer != NULL) {
+    ss_thumbnailer_free (window->thumbnailer);
+  }
 #endif
+  if (window->widget != NULL) {
+    g_object_unref (window->widget);
+  }
+  g_free (window->folded_title);
   g_free (window);
 }
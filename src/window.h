@@ -9,15 +9,49 @@
 
 #include "forward_declarations.h"
 
+// What has changed about a window, according to libwnck, since its widgets
+// were last brought up to date (see ss_window_flush_updates).
+enum {
+  SS_WINDOW_DIRTY_GEOMETRY   = 1 << 0,
+  SS_WINDOW_DIRTY_ICON       = 1 << 1,
+  SS_WINDOW_DIRTY_NAME       = 1 << 2,
+  SS_WINDOW_DIRTY_STATE      = 1 << 3
+};
+
 struct _SSWindow {
   SSScreen *      screen;
   SSWorkspace *   workspace;
   WnckWindow *    wnck_window;
 
+  // The widgets are NULL until the window is first shown (see
+  // ss_window_materialize).
   GtkWidget *   widget;
   GtkWidget *   image;
   GtkWidget *   label;
 
+  // The window's title, lower-cased for searching, and the set of characters
+  // in it (see ss_search_charset).
+  char *    folded_title;
+  guint64   folded_title_charset;
+  int       search_score;
+
+  // 0 for the top-most window in the stacking order, 1 for the next, etc.
+  int   stacking_rank;
+
+  // This window's place in the focus history (see focushistory.h).
+  GList *   mru_link;
+  GList *   workspace_mru_link;
+  guint     focus_stamp;
+  guint     cycle_serial;
+
+  // A cache of the window's _NET_FRAME_EXTENTS, which is invalidated when
+  // the property changes (see ss_xinerama_get_frame_extents).
+  gboolean   frame_extents_are_valid;
+  int        frame_left;
+  int        frame_right;
+  int        frame_top;
+  int        frame_bottom;
+
 #ifdef HAVE_XCOMPOSITE
   SSThumbnailer *   thumbnailer;
 #endif
@@ -30,12 +64,35 @@ struct _SSWindow {
 
   gboolean   sensitive;
 
+  // A bitmask of the SS_WINDOW_DIRTY_* flags, and (for SS_WINDOW_DIRTY_STATE)
+  // which of the window's WnckWindowState bits have changed.
+  guint             dirty_flags;
+  WnckWindowState   dirty_state_mask;
+
+  // The window's index in its workspace's windows array, or -1.
+  int   index_in_workspace;
+
   int   new_window_index;
 };
 
+// libwnck's per-window signals can arrive many times a second (e.g. while a
+// window is being dragged, or while a terminal updates its title), so they are
+// coalesced and applied at most once per WINDOW_UPDATE_INTERVAL_MS.  While the
+// popup is hidden, updates are suspended: they are only applied when the popup
+// is next shown.
+typedef struct _SSWindowUpdateStats SSWindowUpdateStats;
+struct _SSWindowUpdateStats {
+  guint   num_signals;
+  guint   num_updates;
+  guint   num_flushes;
+};
+
 SSWindow *   ss_window_new    (SSWorkspace *workspace, WnckWindow *wnck_window);
 void         ss_window_free   (SSWindow *window);
 
+void   ss_window_materialize     (SSWindow *window);
+void   ss_window_dematerialize   (SSWindow *window);
+
 void   ss_window_activate_window                 (SSWindow *window, guint32 time, gboolean also_warp_pointer_if_necessary);
 void   ss_window_activate_workspace_and_window   (SSWindow *window, guint32 time, gboolean also_warp_pointer_if_necessary);
 void   ss_window_move_to_workspace               (SSWindow *window, SSWorkspace *workspace);
@@ -44,4 +101,8 @@ void   ss_window_set_sensitive                   (SSWindow *window, gboolean sen
 void   ss_window_update_for_new_workspace        (SSWindow *window, SSWorkspace *new_workspace);
 void   ss_window_update_label_max_width_chars    (SSWindow *window);
 
+void                          ss_window_flush_updates           (void);
+void                          ss_window_set_updates_suspended   (gboolean suspended);
+const SSWindowUpdateStats *   ss_window_get_update_stats        (void);
+
 #endif
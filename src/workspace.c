@@ -6,7 +6,9 @@
 #include <X11/X.h>
 
 #include "draganddrop.h"
+#include "focushistory.h"
 #include "screen.h"
+#include "trace.h"
 #include "window.h"
 
 //------------------------------------------------------------------------------
@@ -16,88 +18,198 @@
 
 //------------------------------------------------------------------------------
 
+// Brings the index_in_workspace of the windows in [from, to) up to date.
 static void
-workspace_remove_window_widgets (SSWorkspace *workspace)
+update_window_indices (SSWorkspace *workspace, guint from, guint to)
 {
-  GList *children;
-  GList *i;
-  GtkWidget *child;
-  GtkContainer *container;
-
-  container = GTK_CONTAINER (workspace->window_container);
-  children = gtk_container_get_children (container);
-  for (i = children; i; i = i->next) {
-    child = GTK_WIDGET (i->data);
-    gtk_container_remove (container, child);
+  for (; from < to; from++) {
+    ((SSWindow *) g_ptr_array_index (workspace->windows, from))->index_in_workspace = from;
   }
-  g_list_free (children);
 }
 
 //------------------------------------------------------------------------------
 
-static void
-workspace_add_window_widgets (SSWorkspace *workspace)
+void
+ss_workspace_add_window (SSWorkspace *workspace, SSWindow *window)
 {
-  GList *i;
-  SSWindow *window;
+  if (window == NULL) {
+    return;
+  }
+  g_ptr_array_add (workspace->windows, window);
+  window->index_in_workspace = workspace->windows->len - 1;
+  ss_workspace_invalidate_mini_map (workspace);
+  workspace->screen->workspace_stacking_orders_are_stale = TRUE;
+  ss_focus_history_add_window_to_workspace (
+    workspace->screen->focus_history, window, workspace);
 
-  for (i = workspace->windows; i; i = i->next) {
-    window = (SSWindow *) i->data;
-    gtk_box_pack_start (GTK_BOX (workspace->window_container),
-      window->widget, FALSE, FALSE, 0);
+  if (window->new_window_index != -1) {
+    ss_workspace_reorder_window (workspace, window,
+      window->new_window_index);
+  }
+  if (!workspace->screen->is_suspended) {
+    ss_workspace_update_visible_windows (workspace);
   }
 }
 
 //------------------------------------------------------------------------------
 
 void
-ss_workspace_add_window (SSWorkspace *workspace, SSWindow *window)
+ss_workspace_remove_window (SSWorkspace *workspace, SSWindow *window)
 {
   if (window == NULL) {
     return;
   }
-  workspace->windows = g_list_append (workspace->windows, window);
-  gtk_box_pack_start (GTK_BOX (workspace->window_container),
-    window->widget, TRUE, TRUE, 0);
+  g_ptr_array_remove_index (workspace->windows, window->index_in_workspace);
+  update_window_indices (workspace, window->index_in_workspace, workspace->windows->len);
+  window->index_in_workspace = -1;
+  ss_workspace_invalidate_mini_map (workspace);
+  workspace->screen->workspace_stacking_orders_are_stale = TRUE;
+  ss_focus_history_remove_window_from_workspace (
+    workspace->screen->focus_history, window, workspace);
+  if ((window->widget != NULL) && (window->widget->parent == workspace->window_container)) {
+    gtk_container_remove (GTK_CONTAINER (workspace->window_container), window->widget);
+    g_ptr_array_remove (workspace->visible_windows, window);
+  }
+  // Only visible windows keep their widgets.  If the window is moving to a
+  // workspace where it is in view, that workspace re-materializes it.
+  ss_window_dematerialize (window);
+  if (!workspace->screen->is_suspended) {
+    ss_workspace_update_visible_windows (workspace);
+  }
+}
 
-  if (window->new_window_index != -1) {
-    ss_workspace_reorder_window (workspace, window,
-      window->new_window_index);
+//------------------------------------------------------------------------------
+
+static void
+update_more_label (GtkWidget *label, const char *arrow, int num_windows)
+{
+  char *text;
+
+  if (num_windows <= 0) {
+    gtk_widget_hide (label);
+    return;
   }
+  text = g_strdup_printf ("%s %d more", arrow, num_windows);
+  gtk_label_set_text (GTK_LABEL (label), text);
+  g_free (text);
+  gtk_widget_show (label);
 }
 
 //------------------------------------------------------------------------------
 
+// Makes the window_container hold exactly the widgets of the windows from
+// first_visible_index onwards (up to the screen's max_window_rows), in
+// order.  Windows that scroll out of view lose their widgets (see
+// ss_window_dematerialize), and windows that scroll into view (or have never
+// been shown) get theirs.  This costs O(visible rows), however many windows
+// there are.
 void
-ss_workspace_remove_window (SSWorkspace *workspace, SSWindow *window)
+ss_workspace_update_visible_windows (SSWorkspace *workspace)
 {
-  if (window == NULL) {
+  SSWindow *window;
+  GtkBox *box;
+  int n, num_visible, first;
+  int i;
+
+  box = GTK_BOX (workspace->window_container);
+  n = workspace->windows->len;
+  num_visible = MIN (n, MAX (1, workspace->screen->max_window_rows));
+  first = CLAMP (workspace->first_visible_index, 0, n - num_visible);
+  workspace->first_visible_index = first;
+
+  for (i = workspace->visible_windows->len - 1; i >= 0; i--) {
+    window = (SSWindow *) g_ptr_array_index (workspace->visible_windows, i);
+    if ((window->index_in_workspace < first) ||
+        (window->index_in_workspace >= first + num_visible)) {
+      gtk_container_remove (GTK_CONTAINER (box), window->widget);
+      ss_window_dematerialize (window);
+    }
+  }
+
+  g_ptr_array_set_size (workspace->visible_windows, 0);
+  for (i = first; i < first + num_visible; i++) {
+    window = (SSWindow *) g_ptr_array_index (workspace->windows, i);
+    ss_window_materialize (window);
+    if (window->widget->parent == NULL) {
+      ss_window_update_label_max_width_chars (window);
+      gtk_box_pack_start (box, window->widget, FALSE, FALSE, 0);
+    }
+    gtk_box_reorder_child (box, window->widget, i - first);
+    g_ptr_array_add (workspace->visible_windows, window);
+  }
+
+  update_more_label (workspace->more_above_label, "\xe2\x96\xb2", first);
+  update_more_label (workspace->more_below_label, "\xe2\x96\xbc", n - first - num_visible);
+}
+
+//------------------------------------------------------------------------------
+
+// Scrolls the workspace's rows, if need be, so that the window is visible.
+// While the popup is hidden, this only moves first_visible_index, and the
+// widgets catch up when the popup is next shown.
+void
+ss_workspace_scroll_to_window (SSWorkspace *workspace, SSWindow *window)
+{
+  int index, max_rows;
+
+  if ((workspace == NULL) || (window == NULL) || (window->workspace != workspace)) {
     return;
   }
-  workspace->windows = g_list_remove (workspace->windows, window);
-  gtk_container_remove (GTK_CONTAINER (workspace->window_container), window->widget);
+  index = window->index_in_workspace;
+  max_rows = MAX (1, workspace->screen->max_window_rows);
+  if (index < workspace->first_visible_index) {
+    workspace->first_visible_index = index;
+  } else if (index >= workspace->first_visible_index + max_rows) {
+    workspace->first_visible_index = index - max_rows + 1;
+  }
+  if (!workspace->screen->is_suspended) {
+    ss_workspace_update_visible_windows (workspace);
+  }
 }
 
 //------------------------------------------------------------------------------
 
+// Moves the window (and only the window's widget) to new_index.  Only the
+// windows between the old and new index are shifted along, so moving a
+// window up or down by one costs the same however many windows there are.
 void
 ss_workspace_reorder_window (SSWorkspace *workspace, SSWindow *window, int new_index)
 {
   int n;
+  int old_index;
+  gpointer *pdata;
+
   if (window == NULL) {
     return;
   }
-  n = g_list_length (workspace->windows);
+  n = workspace->windows->len;
   if (new_index < 0) {
     new_index = 0;
   }
-  if (new_index > n) {
-    new_index = n;
+  if (new_index > n - 1) {
+    new_index = n - 1;
+  }
+  old_index = window->index_in_workspace;
+  if (old_index == new_index) {
+    return;
+  }
+
+  pdata = workspace->windows->pdata;
+  if (old_index < new_index) {
+    g_memmove (&pdata[old_index], &pdata[old_index + 1],
+      (new_index - old_index) * sizeof (gpointer));
+    pdata[new_index] = window;
+    update_window_indices (workspace, old_index, new_index + 1);
+  } else {
+    g_memmove (&pdata[new_index + 1], &pdata[new_index],
+      (old_index - new_index) * sizeof (gpointer));
+    pdata[new_index] = window;
+    update_window_indices (workspace, new_index, old_index + 1);
+  }
+
+  if (!workspace->screen->is_suspended) {
+    ss_workspace_scroll_to_window (workspace, window);
   }
-  workspace->windows = g_list_remove (workspace->windows, window);
-  workspace->windows = g_list_insert (workspace->windows, window, new_index);
-  workspace_remove_window_widgets (workspace);
-  workspace_add_window_widgets (workspace);
 }
 
 //------------------------------------------------------------------------------
@@ -153,7 +265,7 @@ on_button_release_event (GtkWidget *widget, GdkEventButton *event, gpointer data
   SSDragAndDrop *dnd;
   gboolean shifted;
   gboolean ctrled;
-  GList *i;
+  guint k;
   SSWindow *window;
 
   workspace = (SSWorkspace *) data;
@@ -167,11 +279,11 @@ on_button_release_event (GtkWidget *widget, GdkEventButton *event, gpointer data
     if (dnd->drag_workspace != NULL) {
       // This simple if clause is to avoid unnecessary work.
       if (dnd->drag_workspace != workspace) {
-        for (i = workspace->windows; i; i = i->next) {
+        for (k = 0; k < workspace->windows->len; k++) {
           // TODO - something weird is going on when dragging a workspace with
           // multiple windows - only the first one is being moved. Perhaps we're
           // modifying the list whilst iterating over it?
-          window = (SSWindow *) i->data;
+          window = (SSWindow *) g_ptr_array_index (workspace->windows, k);
           ss_window_move_to_workspace (window, dnd->drag_workspace);
         }
       }
@@ -203,20 +315,20 @@ on_motion_notify_event (GtkWidget *widget, GdkEventMotion *event, gpointer data)
 //------------------------------------------------------------------------------
 
 static void
-on_expose_event_draw_text (GtkWidget *widget, SSWorkspace *workspace)
+draw_mini_map_text (GdkDrawable *drawable, SSWorkspace *workspace, int w, int h)
 {
 #ifdef HAVE_GTK_2_8
   cairo_t *c;
   cairo_text_extents_t extents;
   int x, y;
 
-  c = gdk_cairo_create (widget->window);
+  c = gdk_cairo_create (drawable);
   cairo_select_font_face (c, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
   cairo_set_font_size (c, MINI_WORKSPACE_FONT_HEIGHT);
 
   cairo_text_extents (c, workspace->title, &extents);
-  x = (widget->allocation.width  - extents.width)  / 2;
-  y = (widget->allocation.height + extents.height) / 2;
+  x = (w - extents.width)  / 2;
+  y = (h + extents.height) / 2;
 
   cairo_set_source_rgba (c, 0, 0, 0, 0.25);
   cairo_move_to (c, x-1, y);
@@ -230,35 +342,28 @@ on_expose_event_draw_text (GtkWidget *widget, SSWorkspace *workspace)
 
 //------------------------------------------------------------------------------
 
-static gboolean
-on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
+static void
+draw_mini_map (GtkWidget *widget, SSWorkspace *workspace, GdkDrawable *drawable, int w, int h)
 {
-  SSWorkspace *workspace;
   int screen_width, screen_height;
   double width_ratio, height_ratio;
-  int x, y, w, h;
   int viewport_x;
-  GList *i;
+  GPtrArray *windows;
+  guint i;
   SSWindow *active_window;
   WnckWindow *wnck_window;
   int state;
   GdkRectangle r;
 
-  workspace = (SSWorkspace *) data;
   screen_width  = workspace->screen->screen_width;
   screen_height = workspace->screen->screen_height;
   active_window = workspace->screen->active_window;
 
-  x = widget->allocation.x;
-  y = widget->allocation.y;
-  w = widget->allocation.width;
-  h = widget->allocation.height;
-
   state = (workspace == workspace->screen->active_workspace) ? GTK_STATE_SELECTED : GTK_STATE_NORMAL;
-  gdk_draw_rectangle (widget->window,
+  gdk_draw_rectangle (drawable,
     widget->style->dark_gc[state], TRUE,
     1, 1, w-2, h-2);
-  gdk_draw_rectangle (widget->window,
+  gdk_draw_rectangle (drawable,
     widget->style->base_gc[state], FALSE,
     0, 0, w-1, h-1);
 
@@ -270,11 +375,9 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
     viewport_x = wnck_workspace_get_viewport_x (workspace->wnck_workspace);
   }
 
-  for (i = workspace->screen->wnck_windows_in_stacking_order; i; i = i->next) {
-    wnck_window = (WnckWindow *) i->data;
-    if (wnck_window_get_workspace (wnck_window) != workspace->wnck_workspace) {
-      continue;
-    }
+  windows = ss_screen_get_stacking_order_for_workspace (workspace->screen, workspace);
+  for (i = 0; i < windows->len; i++) {
+    wnck_window = ((SSWindow *) g_ptr_array_index (windows, i))->wnck_window;
     if (wnck_window_is_minimized (wnck_window)) {
       continue;
     }
@@ -301,42 +404,104 @@ on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
       r.height = 3;
     }
 
-    gdk_draw_rectangle (widget->window,
+    gdk_draw_rectangle (drawable,
       widget->style->bg_gc[state], TRUE,
       r.x+1, r.y+1, r.width-2, r.height-2);
-    gdk_draw_rectangle (widget->window,
+    gdk_draw_rectangle (drawable,
       widget->style->fg_gc[state], FALSE,
       r.x,   r.y,   r.width-1, r.height-1);
   }
 
-  on_expose_event_draw_text (widget, workspace);
+  draw_mini_map_text (drawable, workspace, w, h);
+}
+
+//------------------------------------------------------------------------------
+
+static gboolean
+on_expose_event (GtkWidget *widget, GdkEventExpose *event, gpointer data)
+{
+  SSWorkspace *workspace;
+  int w, h;
+  int pw, ph;
+  guint64 trace_start_us;
+
+  trace_start_us = SS_TRACE_BEGIN ();
+  workspace = (SSWorkspace *) data;
+  w = widget->allocation.width;
+  h = widget->allocation.height;
+
+  if (workspace->mini_map != NULL) {
+    gdk_drawable_get_size (workspace->mini_map, &pw, &ph);
+    if ((pw != w) || (ph != h)) {
+      g_object_unref (workspace->mini_map);
+      workspace->mini_map = NULL;
+    }
+  }
+  if (workspace->mini_map == NULL) {
+    workspace->mini_map = gdk_pixmap_new (widget->window, w, h, -1);
+    workspace->mini_map_is_dirty = TRUE;
+  }
+  if (workspace->mini_map_is_dirty) {
+    draw_mini_map (widget, workspace, workspace->mini_map, w, h);
+    workspace->mini_map_is_dirty = FALSE;
+  }
+
+  gdk_draw_drawable (widget->window, widget->style->fg_gc[GTK_STATE_NORMAL],
+    workspace->mini_map,
+    event->area.x, event->area.y, event->area.x, event->area.y,
+    event->area.width, event->area.height);
+  SS_TRACE_END ("workspace on_expose_event", trace_start_us);
   return FALSE;
 }
 
 //------------------------------------------------------------------------------
 
+static void
+on_style_set (GtkWidget *widget, GtkStyle *previous_style, gpointer data)
+{
+  ss_workspace_invalidate_mini_map ((SSWorkspace *) data);
+}
+
+//------------------------------------------------------------------------------
+
+// Marks the mini-map as needing to be re-drawn, e.g. because one of this
+// workspace's windows moved, was restacked or was minimized.
+void
+ss_workspace_invalidate_mini_map (SSWorkspace *workspace)
+{
+  if (workspace == NULL) {
+    return;
+  }
+  workspace->mini_map_is_dirty = TRUE;
+  gtk_widget_queue_draw (workspace->header);
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the (logical) index in the workspace's windows at which a window
+// dropped at (x, y) would go.  Only the visible rows have allocations, so a
+// drop above or below them goes just before or after them.
 int
 ss_workspace_find_index_near_point (SSWorkspace *workspace, int x, int y)
 {
-  GList *i;
-  int index;
+  int i;
   int n;
   SSWindow *window;
   GtkAllocation *a;
 
-  n = g_list_length (workspace->windows);
+  n = workspace->visible_windows->len;
   if (n == 0) {
-    return -1;
+    return workspace->windows->len == 0 ? -1 : workspace->first_visible_index;
   }
 
-  for (i = workspace->windows, index = 0; i; i = i->next, index++) {
-    window = (SSWindow *) i->data;
+  for (i = 0; i < n; i++) {
+    window = (SSWindow *) g_ptr_array_index (workspace->visible_windows, i);
     a = &window->widget->allocation;
     if (y < (a->y + (a->height + WINDOW_ROW_SPACING) / 2)) {
-      return index;
+      return window->index_in_workspace;
     }
   }
-  return n;
+  return workspace->first_visible_index + n;
 }
 
 //------------------------------------------------------------------------------
@@ -351,6 +516,8 @@ ss_workspace_new (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport)
   GtkWidget *align_h;
   GtkWidget *box_2;
   GtkWidget *align_2;
+  GtkWidget *more_above_label;
+  GtkWidget *more_below_label;
 
   box = gtk_vbox_new (FALSE, 3);
   align = gtk_alignment_new (0.5, 0.0, 0.0, 0.0);
@@ -370,11 +537,19 @@ ss_workspace_new (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport)
   gtk_box_pack_start (GTK_BOX (box), align_h, FALSE, FALSE, 0);
   gtk_box_pack_start (GTK_BOX (box), gtk_hseparator_new (), TRUE, TRUE, 0);
 
+  more_above_label = gtk_label_new ("");
+  gtk_widget_set_no_show_all (more_above_label, TRUE);
+  gtk_box_pack_start (GTK_BOX (box), more_above_label, FALSE, FALSE, 0);
+
   box_2 = gtk_vbox_new (FALSE, WINDOW_ROW_SPACING);
   align_2 = gtk_alignment_new (0.5, 0.5, 0.0, 0.0);
   gtk_container_add (GTK_CONTAINER (align_2), box_2);
   gtk_box_pack_start (GTK_BOX (box), align_2, TRUE, TRUE, 0);
 
+  more_below_label = gtk_label_new ("");
+  gtk_widget_set_no_show_all (more_below_label, TRUE);
+  gtk_box_pack_start (GTK_BOX (box), more_below_label, FALSE, FALSE, 0);
+
   w = g_new (SSWorkspace, 1);
   w->screen = screen;
   w->wnck_workspace = wnck_workspace;
@@ -382,11 +557,22 @@ ss_workspace_new (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport)
   w->widget = align;
   w->header = header;
   w->window_container = box_2;
+  w->more_above_label = more_above_label;
+  w->more_below_label = more_below_label;
   w->title = "";
-  w->windows = NULL;
+  w->windows_in_stacking_order = g_ptr_array_new ();
+  w->mru_windows = g_queue_new ();
+  w->mini_map = NULL;
+  w->mini_map_is_dirty = TRUE;
+  w->windows = g_ptr_array_new ();
+  w->first_visible_index = 0;
+  w->visible_windows = g_ptr_array_new ();
   g_signal_connect (G_OBJECT (header), "expose-event",
     (GCallback) on_expose_event,
     w);
+  g_signal_connect (G_OBJECT (header), "style-set",
+    (GCallback) on_style_set,
+    w);
   g_signal_connect (G_OBJECT (header), "button-press-event",
     (GCallback) on_button_press_event,
     w);
@@ -411,7 +597,13 @@ ss_workspace_free (SSWorkspace *workspace)
   if (workspace == NULL) {
     return;
   }
-  g_list_free (workspace->windows);
+  g_ptr_array_free (workspace->windows, TRUE);
+  g_ptr_array_free (workspace->visible_windows, TRUE);
+  g_ptr_array_free (workspace->windows_in_stacking_order, TRUE);
+  g_queue_free (workspace->mru_windows);
+  if (workspace->mini_map != NULL) {
+    g_object_unref (workspace->mini_map);
+  }
   g_object_unref (workspace->widget);
   g_free (workspace);
 }
@@ -17,9 +17,34 @@ struct _SSWorkspace {
   GtkWidget *   widget;
   GtkWidget *   header;
   GtkWidget *   window_container;
+  GtkWidget *   more_above_label;
+  GtkWidget *   more_below_label;
   char *        title;
 
-  GList *   windows;
+  // This workspace's windows, in the order that they are shown.  Each
+  // SSWindow knows its own index_in_workspace.
+  GPtrArray *   windows;
+
+  // Only a window of rows (at most the screen's max_window_rows, starting at
+  // first_visible_index) has widgets packed into the window_container, so
+  // that a workspace with hundreds of windows costs no more to show, lay out
+  // or draw than one that fits on the monitor.  visible_windows holds the
+  // windows whose widgets are packed, in order.
+  int           first_visible_index;
+  GPtrArray *   visible_windows;
+
+  // This workspace's windows, most recently focused first.
+  GQueue *   mru_windows;
+
+  // This workspace's windows, in bottom-to-top stacking order.  Use
+  // ss_screen_get_stacking_order_for_workspace rather than reading it
+  // directly, since it is only brought up to date on demand.
+  GPtrArray *   windows_in_stacking_order;
+
+  // The header's mini-map is drawn once into this pixmap, and re-drawn only
+  // after ss_workspace_invalidate_mini_map, so that an expose is one blit.
+  GdkPixmap *   mini_map;
+  gboolean      mini_map_is_dirty;
 };
 
 SSWorkspace *   ss_workspace_new    (SSScreen *screen, WnckWorkspace *wnck_workspace, int viewport);
@@ -31,4 +56,8 @@ void   ss_workspace_reorder_window   (SSWorkspace *workspace, SSWindow *window,
 
 int   ss_workspace_find_index_near_point (SSWorkspace *workspace, int x, int y);
 
+void   ss_workspace_invalidate_mini_map   (SSWorkspace *workspace);
+void   ss_workspace_update_visible_windows   (SSWorkspace *workspace);
+void   ss_workspace_scroll_to_window         (SSWorkspace *workspace, SSWindow *window);
+
 #endif
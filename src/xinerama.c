@@ -6,24 +6,32 @@
 #include <gdk/gdk.h>
 #include <glib.h>
 #include <libwnck/libwnck.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef HAVE_XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif
 
+#ifdef HAVE_XCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif
+
 #include "window.h"
 
 //------------------------------------------------------------------------------
 
-SSXinerama *
-ss_xinerama_new (Display *x_display, Window x_root_window)
+// Returns a newly allocated array of the current Xinerama screens (or one
+// screen covering the whole display, if Xinerama is not active).
+static SSXineramaScreen *
+query_screens (Display *x_display, int *out_num_screens)
 {
   int num_screens;
-  int minimum_width;
   SSXineramaScreen *screens;
-  SSXinerama *xinerama;
 
-  minimum_width = 0;
+  num_screens = 0;
+  screens = NULL;
 
 #ifdef HAVE_XINERAMA
   gboolean xinerama_is_active = XineramaIsActive (x_display);
@@ -44,15 +52,13 @@ ss_xinerama_new (Display *x_display, Window x_root_window)
       screens[i].y = xsi->y_org;
       screens[i].width  = xsi->width;
       screens[i].height = xsi->height;
-      if (i == 0) {
-        minimum_width = screens[0].width;
-      } else {
-        minimum_width = MIN (minimum_width, screens[i].width);
-      }
     }
     XFree (xsi_array);
 #endif
-  } else {
+  }
+
+  if (num_screens <= 0) {
+    g_free (screens);
     num_screens = 1;
     int x_screen = DefaultScreen (x_display);
     screens = g_new (SSXineramaScreen, num_screens);
@@ -60,16 +66,165 @@ ss_xinerama_new (Display *x_display, Window x_root_window)
     screens[0].y = 0;
     screens[0].width  = DisplayWidth (x_display, x_screen);
     screens[0].height = DisplayHeight (x_display, x_screen);
-    minimum_width = screens[0].width;
   }
 
+  *out_num_screens = num_screens;
+  return screens;
+}
+
+//------------------------------------------------------------------------------
+
+static int
+compare_ints (gconstpointer a, gconstpointer b)
+{
+  return *((const int *) a) - *((const int *) b);
+}
+
+//------------------------------------------------------------------------------
+
+// Sorts and de-duplicates the n ints in edges, returning the new count.
+static int
+sort_unique_edges (int *edges, int n)
+{
+  int i, j;
+
+  qsort (edges, n, sizeof (int), compare_ints);
+  for (i = 0, j = 0; i < n; i++) {
+    if (j == 0 || edges[j - 1] != edges[i]) {
+      edges[j++] = edges[i];
+    }
+  }
+  return j;
+}
+
+//------------------------------------------------------------------------------
+
+// Returns the index of the cell (between consecutive edges) containing v, or
+// -1 if v is outside all of them.
+static int
+find_cell (int *edges, int num_edges, int v)
+{
+  int lo, hi, mid;
+
+  if (num_edges < 2 || v < edges[0] || v >= edges[num_edges - 1]) {
+    return -1;
+  }
+  lo = 0;
+  hi = num_edges - 1;
+  while (hi - lo > 1) {
+    mid = (lo + hi) / 2;
+    if (v < edges[mid]) {
+      hi = mid;
+    } else {
+      lo = mid;
+    }
+  }
+  return lo;
+}
+
+//------------------------------------------------------------------------------
+
+// Builds the spatial lookup: the screens' left/right and top/bottom edges cut
+// the display into a grid, and each grid cell records which screen (if any)
+// covers it.  Finding the screen under a point is then two binary searches.
+static void
+build_grid (SSXinerama *xinerama)
+{
+  int i, cx, cy;
+  int x, y;
+  SSXineramaScreen *xs;
+
+  g_free (xinerama->grid_x_edges);
+  g_free (xinerama->grid_y_edges);
+  g_free (xinerama->grid_cells);
+
+  xinerama->grid_x_edges = g_new (int, 2 * xinerama->num_screens);
+  xinerama->grid_y_edges = g_new (int, 2 * xinerama->num_screens);
+  for (i = 0; i < xinerama->num_screens; i++) {
+    xs = &xinerama->screens[i];
+    xinerama->grid_x_edges[2 * i]     = xs->x;
+    xinerama->grid_x_edges[2 * i + 1] = xs->x + xs->width;
+    xinerama->grid_y_edges[2 * i]     = xs->y;
+    xinerama->grid_y_edges[2 * i + 1] = xs->y + xs->height;
+  }
+  xinerama->grid_num_x_edges = sort_unique_edges (xinerama->grid_x_edges, 2 * xinerama->num_screens);
+  xinerama->grid_num_y_edges = sort_unique_edges (xinerama->grid_y_edges, 2 * xinerama->num_screens);
+
+  xinerama->grid_cells = g_new (int,
+      MAX (1, (xinerama->grid_num_x_edges - 1) * (xinerama->grid_num_y_edges - 1)));
+  for (cy = 0; cy < xinerama->grid_num_y_edges - 1; cy++) {
+    for (cx = 0; cx < xinerama->grid_num_x_edges - 1; cx++) {
+      x = xinerama->grid_x_edges[cx];
+      y = xinerama->grid_y_edges[cy];
+      xinerama->grid_cells[cy * (xinerama->grid_num_x_edges - 1) + cx] = -1;
+      for (i = 0; i < xinerama->num_screens; i++) {
+        xs = &xinerama->screens[i];
+        if (x >= xs->x && x < xs->x + xs->width &&
+            y >= xs->y && y < xs->y + xs->height) {
+          xinerama->grid_cells[cy * (xinerama->grid_num_x_edges - 1) + cx] = i;
+          break;
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Re-queries the screens, for example after a RandR screen change.  Returns
+// TRUE if the set of screens actually changed, in which case anything laid
+// out according to them (such as the window label widths) needs updating.
+gboolean
+ss_xinerama_update (SSXinerama *xinerama)
+{
+  int i;
+  int num_screens;
+  SSXineramaScreen *screens;
+
+  screens = query_screens (xinerama->x_display, &num_screens);
+  if (xinerama->screens != NULL && num_screens == xinerama->num_screens &&
+      memcmp (screens, xinerama->screens, num_screens * sizeof (SSXineramaScreen)) == 0) {
+    g_free (screens);
+    return FALSE;
+  }
+
+  g_free (xinerama->screens);
+  xinerama->screens = screens;
+  xinerama->num_screens = num_screens;
+  xinerama->minimum_width = screens[0].width;
+  xinerama->minimum_height = screens[0].height;
+  for (i = 1; i < num_screens; i++) {
+    xinerama->minimum_width = MIN (xinerama->minimum_width, screens[i].width);
+    xinerama->minimum_height = MIN (xinerama->minimum_height, screens[i].height);
+  }
+  build_grid (xinerama);
+  return TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+SSXinerama *
+ss_xinerama_new (Display *x_display, Window x_root_window)
+{
+  SSXinerama *xinerama;
+
   xinerama = g_new (SSXinerama, 1);
   xinerama->x_display = x_display;
   xinerama->x_root_window = x_root_window;
-  xinerama->num_screens = num_screens;
-  xinerama->screens = screens;
-  xinerama->minimum_width = minimum_width;
+  xinerama->num_screens = 0;
+  xinerama->screens = NULL;
+  xinerama->minimum_width = 0;
+  xinerama->minimum_height = 0;
+  xinerama->grid_x_edges = NULL;
+  xinerama->grid_y_edges = NULL;
+  xinerama->grid_num_x_edges = 0;
+  xinerama->grid_num_y_edges = 0;
+  xinerama->grid_cells = NULL;
   xinerama->net_frame_extents_atom = XInternAtom (x_display, "_NET_FRAME_EXTENTS", True);
+  xinerama->num_round_trips = 0;
+  xinerama->num_round_trips_since_show = 0;
+  xinerama->num_round_trips_last_show = 0;
+  ss_xinerama_update (xinerama);
   return xinerama;
 }
 
@@ -81,6 +236,7 @@ get_best_screen (SSXinerama *xinerama, SSWindow *window)
   GdkRectangle r;
   SSXineramaScreen *xs;
   int i;
+  int cx, cy;
   int rightmost_left;
   int leftmost_right;
   int bottommost_top;
@@ -93,8 +249,24 @@ get_best_screen (SSXinerama *xinerama, SSWindow *window)
   best_overlapping_area = 0;
   best_screen = 0;
 
-  // first, find out which Xinerama screen the window is most on
   wnck_window_get_geometry (window->wnck_window, &r.x, &r.y, &r.width, &r.height);
+
+  // The common case is that the window lies entirely within one screen, and
+  // so that is the screen under its centre.
+  cx = find_cell (xinerama->grid_x_edges, xinerama->grid_num_x_edges, r.x + r.width / 2);
+  cy = find_cell (xinerama->grid_y_edges, xinerama->grid_num_y_edges, r.y + r.height / 2);
+  if (cx >= 0 && cy >= 0) {
+    i = xinerama->grid_cells[cy * (xinerama->grid_num_x_edges - 1) + cx];
+    if (i >= 0) {
+      xs = &xinerama->screens[i];
+      if (r.x >= xs->x && r.x + r.width <= xs->x + xs->width &&
+          r.y >= xs->y && r.y + r.height <= xs->y + xs->height) {
+        return i;
+      }
+    }
+  }
+
+  // Otherwise, find out which Xinerama screen the window is most on
   for (i = 0; i < xinerama->num_screens; i++) {
     xs = &xinerama->screens[i];
     rightmost_left = MAX (xs->x, r.x);
@@ -121,28 +293,137 @@ get_best_screen (SSXinerama *xinerama, SSWindow *window)
 
 //------------------------------------------------------------------------------
 
+static void
+set_frame_extents (SSWindow *window, int left, int right, int top, int bottom)
+{
+  window->frame_left   = left;
+  window->frame_right  = right;
+  window->frame_top    = top;
+  window->frame_bottom = bottom;
+  window->frame_extents_are_valid = TRUE;
+}
+
+//------------------------------------------------------------------------------
+
+static void
+count_round_trip (SSXinerama *xinerama)
+{
+  xinerama->num_round_trips++;
+  xinerama->num_round_trips_since_show++;
+}
+
+//------------------------------------------------------------------------------
+
+#ifdef HAVE_XCB
+// With XCB, we can send a request and collect its reply later, so that many
+// requests cost (roughly) one round trip rather than one each.
+static xcb_get_property_cookie_t
+request_frame_extents (SSXinerama *xinerama, xcb_connection_t *c, SSWindow *window)
+{
+  return xcb_get_property (c, 0,
+      wnck_window_get_xid (window->wnck_window),
+      xinerama->net_frame_extents_atom,
+      XCB_ATOM_ANY,
+      0,    // long_offset
+      4);   // long_length - we expect 4 32-bit values for _NET_FRAME_EXTENTS
+}
+
+//------------------------------------------------------------------------------
+
+static void
+collect_frame_extents (xcb_connection_t *c, xcb_get_property_cookie_t cookie, SSWindow *window)
+{
+  xcb_get_property_reply_t *reply;
+  xcb_generic_error_t *error;
+  int32_t *values;
+
+  error = NULL;
+  reply = xcb_get_property_reply (c, cookie, &error);
+  if ((reply != NULL) && (reply->format == 32) && (reply->bytes_after == 0) &&
+      (xcb_get_property_value_length (reply) == 4 * sizeof (int32_t))) {
+    values = (int32_t *) xcb_get_property_value (reply);
+    set_frame_extents (window, values[0], values[1], values[2], values[3]);
+  } else {
+    set_frame_extents (window, 0, 0, 0, 0);
+  }
+  free (reply);
+  free (error);
+}
+#endif
+
+//------------------------------------------------------------------------------
+
 static void
 ss_xinerama_get_frame_coordinates (SSXinerama *xinerama, SSWindow *window,
                                    int *out_x, int *out_y, int *out_width, int *out_height)
 {
-  Window x_window, x_root_window, an_ignored_window;
-  int x, y, x_wrt_root, y_wrt_root;
-  unsigned int width, height, border_width, depth;
+  Window x_window;
+  int x_wrt_root, y_wrt_root;
+  unsigned int width, height;
   int frame_left, frame_right, frame_top, frame_bottom;
+#ifdef HAVE_XCB
+  xcb_connection_t *c;
+  xcb_get_geometry_cookie_t geometry_cookie;
+  xcb_translate_coordinates_cookie_t translate_cookie;
+  xcb_get_property_cookie_t extents_cookie;
+  xcb_get_geometry_reply_t *geometry_reply;
+  xcb_translate_coordinates_reply_t *translate_reply;
+  gboolean extents_are_requested;
+#else
+  Window x_root_window, an_ignored_window;
+  int x, y;
+  unsigned int border_width, depth;
+#endif
 
   if (xinerama == NULL || window == NULL) {
     *out_x = *out_y = *out_width = *out_height = -1;
     return;
   }
 
-  // Get the window's co-ordinates...
   x_window = wnck_window_get_xid (window->wnck_window);
+
+#ifdef HAVE_XCB
+  // Send all three requests before waiting for any of the replies.
+  c = XGetXCBConnection (xinerama->x_display);
+  geometry_cookie = xcb_get_geometry (c, x_window);
+  translate_cookie = xcb_translate_coordinates (c, x_window,
+      xinerama->x_root_window, 0, 0);
+  extents_are_requested = !window->frame_extents_are_valid &&
+      (xinerama->net_frame_extents_atom != None);
+  if (extents_are_requested) {
+    extents_cookie = request_frame_extents (xinerama, c, window);
+  }
+
+  geometry_reply = xcb_get_geometry_reply (c, geometry_cookie, NULL);
+  translate_reply = xcb_translate_coordinates_reply (c, translate_cookie, NULL);
+  if (extents_are_requested) {
+    collect_frame_extents (c, extents_cookie, window);
+  }
+  count_round_trip (xinerama);
+
+  width = height = 0;
+  x_wrt_root = y_wrt_root = 0;
+  if (geometry_reply != NULL) {
+    width = geometry_reply->width;
+    height = geometry_reply->height;
+  }
+  if (translate_reply != NULL) {
+    x_wrt_root = translate_reply->dst_x;
+    y_wrt_root = translate_reply->dst_y;
+  }
+  free (geometry_reply);
+  free (translate_reply);
+#else
+  // Get the window's co-ordinates...
   XGetGeometry (xinerama->x_display, x_window, &x_root_window, &x, &y,
                 &width, &height, &border_width, &depth);
+  count_round_trip (xinerama);
 
   // ...with respect to (wrt) the root X Window...
   XTranslateCoordinates (xinerama->x_display, x_window, x_root_window, 0, 0,
                          &x_wrt_root, &y_wrt_root, &an_ignored_window);
+  count_round_trip (xinerama);
+#endif
 
   // ...and adjust for the _NET_FRAME_EXTENTS.
   ss_xinerama_get_frame_extents (
@@ -178,34 +459,105 @@ ss_xinerama_get_frame_extents (SSXinerama *xinerama, SSWindow *window,
     return;
   }
 
-  // Find the _NET_FRAME_EXTENTS, also known as the window border, including
-  // the titlebar and resize grippies.
-  status = XGetWindowProperty(
-    xinerama->x_display,
-    wnck_window_get_xid (window->wnck_window),
-    xinerama->net_frame_extents_atom,
-    0,      // long_offset
-    4,      // long_length - we expect 4 32-bit values for _NET_FRAME_EXTENTS
-    False,  // delete
-    AnyPropertyType,
-    &actual_type,
-    &actual_format,
-    &nitems,
-    &bytes_remaining,
-    &data);
-
-  *out_left = *out_right = *out_top = *out_bottom = 0;
-  if (status == Success) {
-    if ((nitems == 4) && (bytes_remaining == 0)) {
-      // Hoop-jumping to avoid gcc's "dereferencing type-punned pointer" warning
-      data_as_long = (long *) ((void *) data);
-      *out_left   = (int) *(data_as_long++);
-      *out_right  = (int) *(data_as_long++);
-      *out_top    = (int) *(data_as_long++);
-      *out_bottom = (int) *(data_as_long++);
+  // The window's frame extents are cached, and the cache is invalidated by a
+  // PropertyNotify on _NET_FRAME_EXTENTS (see ss_xinerama_is_frame_extents_notify).
+  if (!window->frame_extents_are_valid) {
+    // Find the _NET_FRAME_EXTENTS, also known as the window border, including
+    // the titlebar and resize grippies.
+    status = XGetWindowProperty(
+      xinerama->x_display,
+      wnck_window_get_xid (window->wnck_window),
+      xinerama->net_frame_extents_atom,
+      0,      // long_offset
+      4,      // long_length - we expect 4 32-bit values for _NET_FRAME_EXTENTS
+      False,  // delete
+      AnyPropertyType,
+      &actual_type,
+      &actual_format,
+      &nitems,
+      &bytes_remaining,
+      &data);
+    count_round_trip (xinerama);
+
+    set_frame_extents (window, 0, 0, 0, 0);
+    if (status == Success) {
+      if ((nitems == 4) && (bytes_remaining == 0)) {
+        // Hoop-jumping to avoid gcc's "dereferencing type-punned pointer" warning
+        data_as_long = (long *) ((void *) data);
+        set_frame_extents (window,
+            (int) data_as_long[0], (int) data_as_long[1],
+            (int) data_as_long[2], (int) data_as_long[3]);
+      }
+      XFree (data);
+    }
+  }
+
+  *out_left   = window->frame_left;
+  *out_right  = window->frame_right;
+  *out_top    = window->frame_top;
+  *out_bottom = window->frame_bottom;
+}
+
+//------------------------------------------------------------------------------
+
+// Fills in the frame extents cache for all of the given SSWindows.  With XCB,
+// this sends every request before waiting for any reply, so that it costs
+// one round trip in total, rather than one per window.
+void
+ss_xinerama_prefetch_frame_extents (SSXinerama *xinerama, GPtrArray *windows)
+{
+  SSWindow *window;
+  guint i;
+#ifdef HAVE_XCB
+  xcb_connection_t *c;
+  xcb_get_property_cookie_t *cookies;
+#else
+  int left, right, top, bottom;
+#endif
+
+  if (windows->len == 0) {
+    return;
+  }
+
+#ifdef HAVE_XCB
+  if (xinerama->net_frame_extents_atom == None) {
+    for (i = 0; i < windows->len; i++) {
+      set_frame_extents ((SSWindow *) g_ptr_array_index (windows, i), 0, 0, 0, 0);
     }
-    XFree (data);
+    return;
+  }
+
+  c = XGetXCBConnection (xinerama->x_display);
+  cookies = g_new (xcb_get_property_cookie_t, windows->len);
+  for (i = 0; i < windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (windows, i);
+    cookies[i] = request_frame_extents (xinerama, c, window);
   }
+  for (i = 0; i < windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (windows, i);
+    collect_frame_extents (c, cookies[i], window);
+  }
+  count_round_trip (xinerama);
+  g_free (cookies);
+#else
+  for (i = 0; i < windows->len; i++) {
+    window = (SSWindow *) g_ptr_array_index (windows, i);
+    ss_xinerama_get_frame_extents (xinerama, window, &left, &right, &top, &bottom);
+  }
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+// Returns TRUE if x_event is a PropertyNotify for a change to a window's
+// _NET_FRAME_EXTENTS.  We do not need to select for PropertyChangeMask on
+// client windows ourselves, since libwnck already does so (on the same X
+// connection) to track window titles, states and so on.
+gboolean
+ss_xinerama_is_frame_extents_notify (SSXinerama *xinerama, XEvent *x_event)
+{
+  return (x_event->type == PropertyNotify) &&
+         (x_event->xproperty.atom == xinerama->net_frame_extents_atom);
 }
 
 //------------------------------------------------------------------------------
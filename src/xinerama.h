@@ -4,6 +4,7 @@
 #ifndef SUPERSWITCHER_XINERAMA_H
 #define SUPERSWITCHER_XINERAMA_H
 
+#include <glib.h>
 #include <X11/Xlib.h>
 
 #include "forward_declarations.h"
@@ -21,14 +22,35 @@ struct _SSXinerama {
   int                  num_screens;
   SSXineramaScreen *   screens;
   int                  minimum_width;
+  int                  minimum_height;
   Atom                 net_frame_extents_atom;
+
+  // A spatial lookup for which screen is under a point (see build_grid).
+  int *   grid_x_edges;
+  int *   grid_y_edges;
+  int     grid_num_x_edges;
+  int     grid_num_y_edges;
+  int *   grid_cells;
+
+  // The number of (blocking) round trips to the X server made while querying
+  // window geometry and frame extents, in total and since the popup was last
+  // shown (see ss_screen_prepare_for_show).  num_round_trips_last_show is
+  // how many of those it took to get the last shown popup on screen, as
+  // recorded when the popup was first drawn.
+  guint   num_round_trips;
+  guint   num_round_trips_since_show;
+  guint   num_round_trips_last_show;
 };
 
-SSXinerama *   ss_xinerama_new   (Display *x_display, Window x_root_window);
+SSXinerama *   ss_xinerama_new      (Display *x_display, Window x_root_window);
+gboolean       ss_xinerama_update   (SSXinerama *xinerama);
 
 void   ss_xinerama_move_to_next_screen   (SSXinerama *xinerama, SSWindow *window);
 void   ss_xinerama_get_frame_extents     (SSXinerama *xinerama, SSWindow *window,
                                           int *out_left, int *out_right,
                                           int *out_top, int *out_bottom);
 
+void       ss_xinerama_prefetch_frame_extents    (SSXinerama *xinerama, GPtrArray *windows);
+gboolean   ss_xinerama_is_frame_extents_notify   (SSXinerama *xinerama, XEvent *x_event);
+
 #endif
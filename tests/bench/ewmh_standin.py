@@ -0,0 +1,138 @@
+#!/usr/bin/env python
+# A minimal stand-in for an EWMH window manager, for benchmarking
+# SuperSwitcher on a private Xvfb.  It creates N plain client windows spread
+# across M desktops, advertises itself via _NET_SUPPORTING_WM_CHECK (libwnck
+# wants a window manager name), and services the handful of root window
+# client messages that libwnck sends: _NET_ACTIVE_WINDOW,
+# _NET_CURRENT_DESKTOP, _NET_WM_DESKTOP, _NET_NUMBER_OF_DESKTOPS and
+# _NET_CLOSE_WINDOW.  It does not reparent, decorate or lay out anything.
+#
+# Usage: ewmh_standin.py NUM_WINDOWS NUM_DESKTOPS
+import sys
+from Xlib import X, Xatom, display
+
+d = display.Display()
+root = d.screen().root
+width = d.screen().width_in_pixels
+height = d.screen().height_in_pixels
+
+
+def atom(name):
+    return d.intern_atom(name)
+
+
+def set_cardinals(window, name, values):
+    window.change_property(atom(name), Xatom.CARDINAL, 32, values)
+
+
+def set_windows(window, name, values):
+    window.change_property(atom(name), Xatom.WINDOW, 32, values)
+
+
+def set_utf8(window, name, value):
+    window.change_property(atom(name), atom('UTF8_STRING'), 8,
+                           value.encode('utf-8'))
+
+
+num_windows = int(sys.argv[1])
+num_desktops = int(sys.argv[2])
+current_desktop = 0
+active = 0
+clients = []     # in creation order
+stacking = []    # bottom-to-top
+desktop_of = {}
+
+
+def publish_clients():
+    set_windows(root, '_NET_CLIENT_LIST', [w.id for w in clients])
+    set_windows(root, '_NET_CLIENT_LIST_STACKING', [w.id for w in stacking])
+
+
+def publish_desktops():
+    set_cardinals(root, '_NET_NUMBER_OF_DESKTOPS', [num_desktops])
+    set_cardinals(root, '_NET_CURRENT_DESKTOP', [current_desktop])
+    set_cardinals(root, '_NET_DESKTOP_GEOMETRY', [width, height])
+    set_cardinals(root, '_NET_DESKTOP_VIEWPORT', [0, 0] * num_desktops)
+    set_utf8(root, '_NET_DESKTOP_NAMES',
+             '\0'.join(['Desktop %d' % i for i in range(num_desktops)]))
+
+
+def find_client(xid):
+    for w in clients:
+        if w.id == xid:
+            return w
+    return None
+
+
+root.change_attributes(event_mask=X.SubstructureNotifyMask)
+
+check = root.create_window(-1, -1, 1, 1, 0, X.CopyFromParent)
+set_windows(check, '_NET_SUPPORTING_WM_CHECK', [check.id])
+set_utf8(check, '_NET_WM_NAME', 'ewmh-standin')
+set_windows(root, '_NET_SUPPORTING_WM_CHECK', [check.id])
+root.change_property(atom('_NET_SUPPORTED'), Xatom.ATOM, 32, [atom(a) for a in [
+    '_NET_ACTIVE_WINDOW', '_NET_CLIENT_LIST', '_NET_CLIENT_LIST_STACKING',
+    '_NET_CLOSE_WINDOW', '_NET_CURRENT_DESKTOP', '_NET_DESKTOP_GEOMETRY',
+    '_NET_DESKTOP_VIEWPORT', '_NET_FRAME_EXTENTS', '_NET_NUMBER_OF_DESKTOPS',
+    '_NET_WM_DESKTOP', '_NET_WM_NAME']])
+publish_desktops()
+
+for i in range(num_windows):
+    w = root.create_window(
+        (i * 37) % (width // 2), (i * 23) % (height // 2),
+        width // 3, height // 3, 0, X.CopyFromParent,
+        background_pixel=d.screen().white_pixel)
+    w.set_wm_name('bench window %d' % i)
+    set_utf8(w, '_NET_WM_NAME', 'bench window %d' % i)
+    set_cardinals(w, '_NET_FRAME_EXTENTS', [0, 0, 0, 0])
+    desktop_of[w.id] = i % num_desktops
+    set_cardinals(w, '_NET_WM_DESKTOP', [desktop_of[w.id]])
+    w.map()
+    clients.append(w)
+    stacking.append(w)
+publish_clients()
+set_windows(root, '_NET_ACTIVE_WINDOW', [X.NONE])
+d.sync()
+
+# Tell our parent that we are ready.
+sys.stdout.write('ready\n')
+sys.stdout.flush()
+
+while True:
+    e = d.next_event()
+    if e.type != X.ClientMessage:
+        continue
+    name = d.get_atom_name(e.client_type)
+    fmt, data = e.data
+    if name == '_NET_ACTIVE_WINDOW':
+        w = find_client(e.window.id)
+        if w is None:
+            continue
+        stacking.remove(w)
+        stacking.append(w)
+        w.configure(stack_mode=X.Above)
+        if desktop_of[w.id] != current_desktop:
+            current_desktop = desktop_of[w.id]
+            set_cardinals(root, '_NET_CURRENT_DESKTOP', [current_desktop])
+        publish_clients()
+        set_windows(root, '_NET_ACTIVE_WINDOW', [w.id])
+    elif name == '_NET_CURRENT_DESKTOP':
+        current_desktop = data[0] % num_desktops
+        set_cardinals(root, '_NET_CURRENT_DESKTOP', [current_desktop])
+    elif name == '_NET_WM_DESKTOP':
+        w = find_client(e.window.id)
+        if w is not None:
+            desktop_of[w.id] = data[0] % num_desktops
+            set_cardinals(w, '_NET_WM_DESKTOP', [desktop_of[w.id]])
+    elif name == '_NET_NUMBER_OF_DESKTOPS':
+        num_desktops = max(1, data[0])
+        current_desktop = min(current_desktop, num_desktops - 1)
+        publish_desktops()
+    elif name == '_NET_CLOSE_WINDOW':
+        w = find_client(e.window.id)
+        if w is not None:
+            clients.remove(w)
+            stacking.remove(w)
+            w.destroy()
+            publish_clients()
+    d.flush()
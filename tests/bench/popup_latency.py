@@ -0,0 +1,170 @@
+#!/usr/bin/env python
+# Measures SuperSwitcher's popup latency on a private Xvfb.
+#
+# For each window count N, this starts Xvfb, a private D-Bus session bus,
+# ewmh_standin.py (which creates N windows over M desktops) and
+# SuperSwitcher, and then repeatedly injects (via XTest) the key presses for
+# Super+Tab, a search letter and Return.  It records the time from:
+#   - the Tab KeyPress to the popup's MapNotify ("show"),
+#   - the search KeyPress to the return of a no-op ShowPopup D-Bus call, which
+#     SuperSwitcher only serves once it has handled the key ("search"), and
+#   - the Return KeyPress to the _NET_ACTIVE_WINDOW change ("activate").
+#
+# Requires Xvfb, dbus-launch, python-xlib and dbus-python.  Run it via
+# "make bench", or directly:
+#   popup_latency.py --superswitcher=src/superswitcher [--windows=10,100]
+import optparse, os, select, signal, subprocess, sys, time
+
+import dbus
+from Xlib import X, XK, display
+from Xlib.ext import xtest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TIMEOUT = 5.0
+
+
+def percentile(samples, p):
+    s = sorted(samples)
+    return s[min(len(s) - 1, int(len(s) * p / 100.0))]
+
+
+def wait_for(d, predicate):
+    deadline = time.time() + TIMEOUT
+    while time.time() < deadline:
+        while d.pending_events():
+            e = d.next_event()
+            if predicate(e):
+                return time.time()
+        select.select([d.fileno()], [], [], 0.01)
+    raise RuntimeError('timed out waiting for an X event')
+
+
+def start_xvfb(display_number):
+    xvfb = subprocess.Popen(['Xvfb', ':%d' % display_number,
+                             '-screen', '0', '1280x1024x24', '-nolisten', 'tcp'])
+    socket = '/tmp/.X11-unix/X%d' % display_number
+    for i in range(100):
+        if os.path.exists(socket):
+            return xvfb
+        time.sleep(0.05)
+    raise RuntimeError('Xvfb did not start')
+
+
+def start_session_bus():
+    out = subprocess.check_output(['dbus-launch', '--sh-syntax']).decode()
+    env = {}
+    for line in out.splitlines():
+        if '=' in line:
+            key, value = line.split('=', 1)
+            env[key] = value.split("';")[0].strip("'")
+    return env
+
+
+def get_superswitcher(bus):
+    for i in range(100):
+        try:
+            return bus.get_object('superswitcher.SuperSwitcher',
+                                  '/superswitcher/SuperSwitcher')
+        except dbus.DBusException:
+            time.sleep(0.05)
+    raise RuntimeError('SuperSwitcher did not start')
+
+
+def run(superswitcher, num_windows, num_desktops, repeats, display_number):
+    xvfb = start_xvfb(display_number)
+    bus_env = start_session_bus()
+    os.environ['DISPLAY'] = ':%d' % display_number
+    os.environ.update(bus_env)
+    children = []
+    try:
+        standin = subprocess.Popen(
+            [sys.executable, os.path.join(HERE, 'ewmh_standin.py'),
+             str(num_windows), str(num_desktops)], stdout=subprocess.PIPE)
+        children.append(standin)
+        standin.stdout.readline()
+        children.append(subprocess.Popen([superswitcher]))
+        ss = get_superswitcher(dbus.SessionBus())
+
+        d = display.Display()
+        root = d.screen().root
+        root.change_attributes(
+            event_mask=X.SubstructureNotifyMask | X.PropertyChangeMask)
+        net_active_window = d.intern_atom('_NET_ACTIVE_WINDOW')
+
+        def keycode(name):
+            return d.keysym_to_keycode(XK.string_to_keysym(name))
+
+        super_key = keycode('Super_L')
+        tab_key = keycode('Tab')
+        search_key = keycode('b')
+        return_key = keycode('Return')
+
+        # Make sure that Super_L is Mod4, which is what SuperSwitcher grabs.
+        mods = [list(m) for m in d.get_modifier_mapping()]
+        if super_key not in mods[X.Mod4MapIndex]:
+            mods[X.Mod4MapIndex] = [k for k in mods[X.Mod4MapIndex] if k] + [super_key]
+            d.set_modifier_mapping(mods)
+
+        def press(key):
+            xtest.fake_input(d, X.KeyPress, key)
+            d.sync()
+            return time.time()
+
+        def release(key):
+            xtest.fake_input(d, X.KeyRelease, key)
+            d.sync()
+
+        results = {'show': [], 'search': [], 'activate': []}
+        for i in range(repeats):
+            press(super_key)
+            t = press(tab_key)
+            results['show'].append(wait_for(d, lambda e:
+                e.type == X.MapNotify and e.override) - t)
+
+            t = press(search_key)
+            release(search_key)
+            ss.ShowPopup()
+            results['search'].append(time.time() - t)
+
+            t = press(return_key)
+            results['activate'].append(wait_for(d, lambda e:
+                e.type == X.PropertyNotify and e.atom == net_active_window) - t)
+            release(return_key)
+
+            release(tab_key)
+            wait_for(d, lambda e: e.type == X.UnmapNotify)
+            release(super_key)
+        return results
+    finally:
+        for child in reversed(children):
+            child.terminate()
+            child.wait()
+        os.kill(int(bus_env['DBUS_SESSION_BUS_PID']), signal.SIGTERM)
+        xvfb.terminate()
+        xvfb.wait()
+
+
+def main():
+    parser = optparse.OptionParser()
+    parser.add_option('--superswitcher', default='src/superswitcher')
+    parser.add_option('--windows', default='10,100,500,1000,2000')
+    parser.add_option('--desktops', type='int', default=4)
+    parser.add_option('--repeats', type='int', default=20)
+    parser.add_option('--display', type='int', default=73)
+    options, args = parser.parse_args()
+
+    print('%6s  %-26s  %-26s  %-26s' % ('N', 'show p50/p90/p99 (ms)',
+        'search p50/p90/p99 (ms)', 'activate p50/p90/p99 (ms)'))
+    for n in [int(x) for x in options.windows.split(',')]:
+        results = run(options.superswitcher, n, options.desktops,
+                      options.repeats, options.display)
+        columns = []
+        for key in ['show', 'search', 'activate']:
+            columns.append('%7.2f %7.2f %7.2f' % tuple(
+                1000 * percentile(results[key], p) for p in [50, 90, 99]))
+        print('%6d  %-26s  %-26s  %-26s' % tuple([n] + columns))
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
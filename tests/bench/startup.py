@@ -0,0 +1,109 @@
+#!/usr/bin/env python
+# Measures SuperSwitcher's startup time and resident memory on a private Xvfb.
+#
+# For each window count N, this starts Xvfb, a private D-Bus session bus and
+# ewmh_standin.py (see popup_latency.py), and then starts SuperSwitcher
+# several times.  It records:
+#   - the time from exec to the return of the first (no-op) HidePopup D-Bus
+#     call, which SuperSwitcher only serves once it is in its main loop
+#     ("startup"),
+#   - VmRSS at that point ("rss"),
+#   - the time taken by the first ShowPopup D-Bus call, which is when the
+#     window widgets are built ("first show"), and
+#   - VmRSS after that first show ("rss after show").
+#
+# Requires Xvfb, dbus-launch, python-xlib and dbus-python.  Run it via
+# "make bench-startup", or directly:
+#   startup.py --superswitcher=src/superswitcher [--windows=10,500]
+import optparse, os, signal, subprocess, sys, time
+
+import dbus
+
+from popup_latency import HERE, percentile, start_xvfb, start_session_bus
+
+
+def rss_kb(pid):
+    for line in open('/proc/%d/status' % pid):
+        if line.startswith('VmRSS:'):
+            return int(line.split()[1])
+    return 0
+
+
+def call_when_ready(bus, method):
+    for i in range(1000):
+        try:
+            ss = bus.get_object('superswitcher.SuperSwitcher',
+                                '/superswitcher/SuperSwitcher')
+            getattr(ss, method)()
+            return ss
+        except dbus.DBusException:
+            time.sleep(0.005)
+    raise RuntimeError('SuperSwitcher did not start')
+
+
+def run(superswitcher, num_windows, num_desktops, repeats, display_number):
+    xvfb = start_xvfb(display_number)
+    bus_env = start_session_bus()
+    os.environ['DISPLAY'] = ':%d' % display_number
+    os.environ.update(bus_env)
+    standin = None
+    try:
+        standin = subprocess.Popen(
+            [sys.executable, os.path.join(HERE, 'ewmh_standin.py'),
+             str(num_windows), str(num_desktops)], stdout=subprocess.PIPE)
+        standin.stdout.readline()
+        bus = dbus.SessionBus()
+
+        results = {'startup': [], 'rss': [], 'show': [], 'rss_show': []}
+        for i in range(repeats):
+            t = time.time()
+            child = subprocess.Popen([superswitcher])
+            try:
+                ss = call_when_ready(bus, 'HidePopup')
+                results['startup'].append(time.time() - t)
+                results['rss'].append(rss_kb(child.pid))
+
+                t = time.time()
+                ss.ShowPopup()
+                results['show'].append(time.time() - t)
+                ss.HidePopup()
+                results['rss_show'].append(rss_kb(child.pid))
+            finally:
+                child.terminate()
+                child.wait()
+        return results
+    finally:
+        if standin is not None:
+            standin.terminate()
+            standin.wait()
+        os.kill(int(bus_env['DBUS_SESSION_BUS_PID']), signal.SIGTERM)
+        xvfb.terminate()
+        xvfb.wait()
+
+
+def main():
+    parser = optparse.OptionParser()
+    parser.add_option('--superswitcher', default='src/superswitcher')
+    parser.add_option('--windows', default='10,100,500,1000')
+    parser.add_option('--desktops', type='int', default=4)
+    parser.add_option('--repeats', type='int', default=10)
+    parser.add_option('--display', type='int', default=74)
+    options, args = parser.parse_args()
+
+    print('%6s  %-18s  %-10s  %-18s  %-14s' % ('N', 'startup p50/p90 (ms)',
+        'rss (KiB)', 'first show p50/p90 (ms)', 'rss after show'))
+    for n in [int(x) for x in options.windows.split(',')]:
+        r = run(options.superswitcher, n, options.desktops,
+                options.repeats, options.display)
+        print('%6d  %8.2f %8.2f    %10d  %8.2f %8.2f       %10d' % (n,
+            1000 * percentile(r['startup'], 50),
+            1000 * percentile(r['startup'], 90),
+            percentile(r['rss'], 50),
+            1000 * percentile(r['show'], 50),
+            1000 * percentile(r['show'], 90),
+            percentile(r['rss_show'], 50)))
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
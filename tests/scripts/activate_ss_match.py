@@ -0,0 +1,12 @@
+#!/usr/bin/env python
+# Activates the window that best matches the query, as if it had been typed
+# into the popup, without showing the popup.
+import dbus, sys
+ss = dbus.SessionBus().get_object('superswitcher.SuperSwitcher',
+                                 '/superswitcher/SuperSwitcher')
+
+xid = ss.ActivateBestMatch(' '.join(sys.argv[1:]))
+if xid == 0:
+    print("No window matches")
+    sys.exit(1)
+print("Activated 0x%08x" % xid)
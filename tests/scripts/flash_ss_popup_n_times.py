@@ -1,5 +1,5 @@
 #!/usr/bin/env python
-import dbus, sys
+import dbus, sys, time
 ss = dbus.SessionBus().get_object('superswitcher.SuperSwitcher',
                                  '/superswitcher/SuperSwitcher')
 
@@ -8,6 +8,21 @@ try:
 except:
     n = 10
 
+show_times = []
+hide_times = []
 for i in range(n):
+    t0 = time.time()
     ss.ShowPopup()
+    t1 = time.time()
     ss.HidePopup()
+    t2 = time.time()
+    show_times.append(t1 - t0)
+    hide_times.append(t2 - t1)
+
+show_times.sort()
+hide_times.sort()
+print("%d show/hide cycles" % n)
+print("ShowPopup: median %.3f ms, max %.3f ms" %
+      (1000 * show_times[n // 2], 1000 * show_times[-1]))
+print("HidePopup: median %.3f ms, max %.3f ms" %
+      (1000 * hide_times[n // 2], 1000 * hide_times[-1]))
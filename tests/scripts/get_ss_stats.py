@@ -0,0 +1,33 @@
+#!/usr/bin/env python
+import dbus
+stats = dbus.SessionBus().get_object('superswitcher.SuperSwitcher',
+                                    '/superswitcher/SuperSwitcher').GetStats()
+
+bounds = stats['histogram_bucket_lower_bounds_us']
+
+def percentile(histogram, count, p):
+    target = count * p
+    seen = 0
+    for i, n in enumerate(histogram):
+        seen += n
+        if seen >= target:
+            return bounds[i]
+    return 0
+
+for name in ('popup_show', 'search_update', 'window_activation',
+             'thumbnail_render'):
+    count = stats[name + '_count']
+    if count == 0:
+        print("%s: no samples" % name)
+        continue
+    histogram = stats[name + '_histogram']
+    print("%s: %d samples, mean %d us, p50 >= %d us, p99 >= %d us, max %d us" %
+          (name, count, stats[name + '_sum_us'] // count,
+           percentile(histogram, count, 0.50),
+           percentile(histogram, count, 0.99),
+           stats[name + '_max_us']))
+
+for key in sorted(stats.keys()):
+    if not (key.endswith('_histogram') or key.endswith('_us') or
+            key.endswith('_count')):
+        print("%s: %d" % (key, stats[key]))
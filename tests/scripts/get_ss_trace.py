@@ -0,0 +1,16 @@
+#!/usr/bin/env python
+# Saves superswitcher's recent trace (it must be running with --trace), for
+# loading into chrome://tracing or https://ui.perfetto.dev.
+import dbus, sys
+trace = dbus.SessionBus().get_object('superswitcher.SuperSwitcher',
+                                    '/superswitcher/SuperSwitcher').GetTrace()
+
+try:
+    filename = sys.argv[1]
+except:
+    filename = 'superswitcher-trace.json'
+
+f = open(filename, 'w')
+f.write(trace)
+f.close()
+print("Wrote %s" % filename)
@@ -0,0 +1,21 @@
+#!/usr/bin/env python
+import dbus
+ss = dbus.SessionBus().get_object('superswitcher.SuperSwitcher',
+                                 '/superswitcher/SuperSwitcher')
+
+for ws in ss.ListWorkspaces():
+    print("%d %s%-3s %s (%d windows)" %
+          (ws['index'], ws['active'] and '*' or ' ', ws['title'], ws['name'],
+           ws['num_windows']))
+
+for w in ss.ListWindows():
+    flags = ''
+    if w['active']:
+        flags += 'A'
+    if w['minimized']:
+        flags += 'M'
+    if w.get('needs_attention'):
+        flags += '!'
+    print("0x%08x mru=%-3d ws=%-2d order=%-3d %-3s %s" %
+          (w['xid'], w['mru_rank'], w['workspace'], w['order'], flags,
+           w['title']))